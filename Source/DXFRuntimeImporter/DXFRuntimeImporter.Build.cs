@@ -28,6 +28,7 @@ public class DXFRuntimeImporter : ModuleRules
 				"Core",
 				"UE_AssimpLibrary",
 				"RuntimeMeshComponent",
+				"RenderCore",
 				"HTTP"
 				// ... add other public dependencies that you statically link with here ...
 			}
@@ -39,7 +40,9 @@ public class DXFRuntimeImporter : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
-				"Projects"
+				"Projects",
+				"Json",
+				"HTTPServer"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMBenchmarkCommandlet.h"
+
+#include "DXFRuntimeImporter.h"
+#include "assimp/Importer.hpp"
+#include "BIMDownload.h"
+#include "BIMImportPipeline.h"
+#include "BIMImportProfile.h"
+#include "BIMMappedFile.h"
+#include "BIMMeshActor.h"
+#include "BIMPolyLineActor.h"
+#include "BIMSpatialIndex.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HttpServerModule.h"
+#include "HttpServerResponse.h"
+#include "IHttpRouter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+// synthetic models put this many entities on each layer, which assimp turns into one mesh
+#define ELEMENTS_PER_LAYER 100
+
+// seconds to wait for a download from the local server
+#define DOWNLOAD_TIMEOUT 120.0
+
+namespace
+{
+	struct FBenchmarkRow
+	{
+		FString Model;
+		int64 FileBytes = 0;
+		bool bSucceeded = false;
+
+		// -1 when the stage didn't run
+		double DownloadMs = -1.0;
+		double ReadMs = 0.0;
+		double PostProcessMs = 0.0;
+		TArray<TPair<FString, double>> PostProcessStepMs;
+		double BuildBuffersMs = 0.0;
+		double SpatialIndexMs = 0.0;
+		double SpawnMs = -1.0;
+
+		int32 Meshes = 0;
+		int32 Lines = 0;
+		int32 Actors = 0;
+		int64 RenderBytes = 0;
+
+		// process high-water mark after the run, and memory still in use at its end compared to its start
+		double PeakUsedMB = 0.0;
+		double UsedDeltaMB = 0.0;
+	};
+
+	double ToMB(int64 Bytes)
+	{
+		return Bytes / (1024.0 * 1024.0);
+	}
+
+	/*
+	 * Write an ASCII DXF with Count entities on a grid: line segments, quads (3DFACE) or both alternating
+	 */
+	bool WriteSyntheticModel(const FString& FilePath, const FString& Kind, int32 Count)
+	{
+		const bool bLines = Kind != TEXT("meshes");
+		const bool bMeshes = Kind != TEXT("lines");
+		const int32 Columns = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count))));
+
+		FString Out;
+		Out.Reserve(Count * 160);
+		Out += TEXT("0\nSECTION\n2\nENTITIES\n");
+		for (int32 i = 0; i < Count; i++)
+		{
+			// meters, two units apart
+			const float X = (i % Columns) * 2.0f;
+			const float Y = (i / Columns) * 2.0f;
+			const int32 Layer = i / ELEMENTS_PER_LAYER;
+
+			if (bLines && (!bMeshes || i % 2 == 0))
+			{
+				Out += FString::Printf(TEXT("0\nLINE\n8\nL%d\n10\n%.3f\n20\n%.3f\n30\n0.0\n11\n%.3f\n21\n%.3f\n31\n1.0\n"),
+					Layer, X, Y, X + 1.0f, Y + 0.5f);
+			}
+			else
+			{
+				Out += FString::Printf(TEXT("0\n3DFACE\n8\nF%d\n10\n%.3f\n20\n%.3f\n30\n0.0\n11\n%.3f\n21\n%.3f\n31\n0.0\n12\n%.3f\n22\n%.3f\n32\n0.5\n13\n%.3f\n23\n%.3f\n33\n0.5\n"),
+					Layer, X, Y, X + 1.0f, Y, X + 1.0f, Y + 1.0f, X, Y + 1.0f);
+			}
+		}
+		Out += TEXT("0\nENDSEC\n0\nEOF\n");
+
+		return FFileHelper::SaveStringToFile(Out, *FilePath, FFileHelper::EEncodingOptions::ForceAnsi);
+	}
+
+	// Outcome of a download, shared with its callback, which may outlive DownloadModel after a timeout
+	struct FDownloadState
+	{
+		bool bDone = false;
+		bool bSucceeded = false;
+	};
+
+	/*
+	 * Download Url to FilePath, ticking the engine's tickers (HTTP manager and local server) until done.
+	 * bOutTimedOut is set if it didn't finish in time: it keeps running, and writing to FilePath, in the background
+	 */
+	bool DownloadModel(const FString& Url, const FString& FilePath, bool& bOutTimedOut)
+	{
+		TSharedRef<FDownloadState, ESPMode::ThreadSafe> State = MakeShared<FDownloadState, ESPMode::ThreadSafe>();
+		FBIMDownload::Start(Url, FilePath, [State](EBIMDownloadResult Result, const FString& Version)
+		{
+			State->bSucceeded = Result == EBIMDownloadResult::Downloaded;
+			State->bDone = true;
+		});
+
+		const double Deadline = FPlatformTime::Seconds() + DOWNLOAD_TIMEOUT;
+		double LastTime = FPlatformTime::Seconds();
+		while (!State->bDone && FPlatformTime::Seconds() < Deadline)
+		{
+			const double Now = FPlatformTime::Seconds();
+			FTicker::GetCoreTicker().Tick(static_cast<float>(Now - LastTime));
+			LastTime = Now;
+			FPlatformProcess::Sleep(0.001f);
+		}
+		bOutTimedOut = !State->bDone;
+		return State->bDone && State->bSucceeded;
+	}
+
+	/*
+	 * Run every stage of the import on one model. World is null when spawning is skipped.
+	 * Returns false if the benchmark can't go on: a download timed out and would still tick with the next model
+	 */
+	bool RunModel(const FString& FilePath, const FString& Url, const FBIMImportSettings& Settings, UWorld* World, FBenchmarkRow& Row)
+	{
+		const int64 UsedBefore = FPlatformMemory::GetStats().UsedPhysical;
+		Row.FileBytes = IFileManager::Get().FileSize(*FilePath);
+
+		FString LocalPath = FilePath;
+		if (!Url.IsEmpty())
+		{
+			LocalPath = FPaths::CreateTempFilename(*(FPaths::ProjectSavedDir() / TEXT("BIMImporter")), TEXT("Download"), TEXT(".tmp"));
+			const double Start = FPlatformTime::Seconds();
+			bool bTimedOut = false;
+			if (!DownloadModel(Url, LocalPath, bTimedOut))
+			{
+				UE_LOG(LogAssimp, Error, TEXT("Could not download %s%s"), *Url, bTimedOut ? TEXT(" in time, stopping the benchmark") : TEXT(""))
+				return !bTimedOut;
+			}
+			Row.DownloadMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+		}
+
+		// parse and post-process, timed by the importer's progress handler
+		FBIMImportResult Result;
+		Result.Importer = MakeShared<Assimp::Importer, ESPMode::ThreadSafe>();
+		{
+			FBIMMappedFile File;
+			if (File.Open(LocalPath))
+			{
+				Result.Scene = FBIMImportPipeline::ReadScene(Result.Importer.Get(), File.GetData(), File.GetSize(), Settings.ImportProfile, Row.Model);
+			}
+		}
+		if (LocalPath != FilePath)
+		{
+			IFileManager::Get().Delete(*LocalPath);
+		}
+		if (!Result.Scene)
+		{
+			UE_LOG(LogAssimp, Error, TEXT("Could not import %s"), *Row.Model)
+			return true;
+		}
+
+		const FBIMImportTimer* Timer = static_cast<const FBIMImportTimer*>(Result.Importer->GetProgressHandler());
+		Row.ReadMs = Timer->GetReadSeconds() * 1000.0;
+		Row.PostProcessMs = Timer->GetPostProcessSeconds() * 1000.0;
+		for (const TPair<FString, double>& Step : Timer->GetStepSeconds())
+		{
+			Row.PostProcessStepMs.Emplace(Step.Key, Step.Value * 1000.0);
+		}
+
+		// tube and mesh buffers, LODs and clusters
+		double Start = FPlatformTime::Seconds();
+		FBIMImportPipeline::SortMeshes(Result);
+		FBIMImportPipeline::BuildBuffers(Result.Scene, Result.MeshObjs, Result.LineObjs, Result.Categories, Result.MeshBuffers, Result.LineBuffers, Settings);
+		Row.BuildBuffersMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+		Row.Meshes = Result.MeshObjs.Num();
+		Row.Lines = Result.LineObjs.Num();
+
+		Start = FPlatformTime::Seconds();
+		FBIMSpatialIndex SpatialIndex;
+		SpatialIndex.Build(Result.MeshBuffers, Result.LineBuffers, ABIMPolyLineActor::GetLineRadius());
+		Row.SpatialIndexMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+
+		// RMC section creation and actor spawning, as the scene does it in one frame
+		if (World)
+		{
+			TArray<AActor*> Actors;
+			Start = FPlatformTime::Seconds();
+			for (const FBIMLineBuffers& Buffers : Result.LineBuffers)
+			{
+				ABIMPolyLineActor* Actor = World->SpawnActor<ABIMPolyLineActor>();
+				Actor->SetInstanceMesh(Settings.LineInstanceMesh);
+				Actor->CreateMeshFromBuffers(Buffers, nullptr);
+				Row.RenderBytes += Actor->GetRenderMemory();
+				Actors.Add(Actor);
+			}
+			for (const FBIMMeshBuffers& Buffers : Result.MeshBuffers)
+			{
+				ABIMMeshActor* Actor = World->SpawnActor<ABIMMeshActor>();
+				Actor->CreateMeshFromBuffers(Buffers, nullptr);
+				Row.RenderBytes += Actor->GetRenderMemory();
+				Actors.Add(Actor);
+			}
+			Row.SpawnMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+			Row.Actors = Actors.Num();
+
+			for (AActor* Actor : Actors)
+			{
+				Actor->Destroy();
+			}
+		}
+		else
+		{
+			Row.Actors = Result.MeshBuffers.Num() + Result.LineBuffers.Num();
+		}
+
+		const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+		Row.PeakUsedMB = ToMB(Stats.PeakUsedPhysical);
+		Row.UsedDeltaMB = ToMB(static_cast<int64>(Stats.UsedPhysical) - UsedBefore);
+		Row.bSucceeded = true;
+		return true;
+	}
+
+	void WriteResults(const FString& BasePath, const TArray<FBenchmarkRow>& Rows)
+	{
+		FString Csv = TEXT("Model,FileBytes,Succeeded,DownloadMs,ReadMs,PostProcessMs,BuildBuffersMs,SpatialIndexMs,SpawnMs,Meshes,Lines,Actors,RenderBytes,PeakUsedMB,UsedDeltaMB\n");
+		TArray<TSharedPtr<FJsonValue>> JsonRows;
+		for (const FBenchmarkRow& Row : Rows)
+		{
+			Csv += FString::Printf(TEXT("%s,%lld,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%d,%d,%lld,%.1f,%.1f\n"),
+				*Row.Model, Row.FileBytes, Row.bSucceeded ? 1 : 0, Row.DownloadMs, Row.ReadMs, Row.PostProcessMs,
+				Row.BuildBuffersMs, Row.SpatialIndexMs, Row.SpawnMs, Row.Meshes, Row.Lines, Row.Actors,
+				Row.RenderBytes, Row.PeakUsedMB, Row.UsedDeltaMB);
+
+			TSharedPtr<FJsonObject> Object = MakeShared<FJsonObject>();
+			Object->SetStringField(TEXT("Model"), Row.Model);
+			Object->SetNumberField(TEXT("FileBytes"), Row.FileBytes);
+			Object->SetBoolField(TEXT("Succeeded"), Row.bSucceeded);
+			Object->SetNumberField(TEXT("DownloadMs"), Row.DownloadMs);
+			Object->SetNumberField(TEXT("ReadMs"), Row.ReadMs);
+			Object->SetNumberField(TEXT("PostProcessMs"), Row.PostProcessMs);
+			TSharedPtr<FJsonObject> Steps = MakeShared<FJsonObject>();
+			for (const TPair<FString, double>& Step : Row.PostProcessStepMs)
+			{
+				Steps->SetNumberField(Step.Key, Step.Value);
+			}
+			Object->SetObjectField(TEXT("PostProcessStepMs"), Steps);
+			Object->SetNumberField(TEXT("BuildBuffersMs"), Row.BuildBuffersMs);
+			Object->SetNumberField(TEXT("SpatialIndexMs"), Row.SpatialIndexMs);
+			Object->SetNumberField(TEXT("SpawnMs"), Row.SpawnMs);
+			Object->SetNumberField(TEXT("Meshes"), Row.Meshes);
+			Object->SetNumberField(TEXT("Lines"), Row.Lines);
+			Object->SetNumberField(TEXT("Actors"), Row.Actors);
+			Object->SetNumberField(TEXT("RenderBytes"), Row.RenderBytes);
+			Object->SetNumberField(TEXT("PeakUsedMB"), Row.PeakUsedMB);
+			Object->SetNumberField(TEXT("UsedDeltaMB"), Row.UsedDeltaMB);
+			JsonRows.Add(MakeShared<FJsonValueObject>(Object));
+		}
+
+		FString Json;
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+		FJsonSerializer::Serialize(JsonRows, Writer);
+
+		FFileHelper::SaveStringToFile(Csv, *(BasePath + TEXT(".csv")));
+		FFileHelper::SaveStringToFile(Json, *(BasePath + TEXT(".json")));
+		UE_LOG(LogAssimp, Display, TEXT("Benchmark results written to %s.csv and .json"), *BasePath)
+	}
+}
+
+UBIMBenchmarkCommandlet::UBIMBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBIMBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString Sizes = TEXT("1000,10000,100000");
+	FString Kinds = TEXT("lines,meshes,mixed");
+	FString Files;
+	FString Profile = TEXT("Balanced");
+	FString OutputDir = FPaths::ProjectSavedDir() / TEXT("BIMImporter") / TEXT("Benchmark");
+	FParse::Value(*Params, TEXT("sizes="), Sizes);
+	FParse::Value(*Params, TEXT("kinds="), Kinds);
+	FParse::Value(*Params, TEXT("files="), Files);
+	FParse::Value(*Params, TEXT("profile="), Profile);
+	FParse::Value(*Params, TEXT("output="), OutputDir);
+
+	// the benchmark measures one stage at a time: no cache, no background tasks
+	FBIMImportSettings Settings;
+	Settings.bUseCache = false;
+	Settings.bAsyncImport = false;
+	const int64 ProfileValue = StaticEnum<EBIMImportProfile>()->GetValueByNameString(Profile);
+	Settings.ImportProfile = FBIMImportProfile::Resolve(ProfileValue == INDEX_NONE ? EBIMImportProfile::ProjectDefault : static_cast<EBIMImportProfile>(ProfileValue));
+
+	// models: given files, then synthetic ones from small to large so the peak memory column stays meaningful
+	TArray<FString> ModelPaths;
+	Files.ParseIntoArray(ModelPaths, TEXT("+"));
+	TArray<FString> SizeList;
+	TArray<FString> KindList;
+	Sizes.ParseIntoArray(SizeList, TEXT(","));
+	Kinds.ParseIntoArray(KindList, TEXT(","));
+	for (const FString& Size : SizeList)
+	{
+		for (const FString& Kind : KindList)
+		{
+			const int32 Count = FCString::Atoi(*Size);
+			const FString ModelPath = OutputDir / FString::Printf(TEXT("%s_%d.dxf"), *Kind, Count);
+			if (Count > 0 && WriteSyntheticModel(ModelPath, Kind, Count))
+			{
+				ModelPaths.Add(ModelPath);
+			}
+		}
+	}
+
+	// optional local HTTP stand-in, one route per model
+	int32 Port = 8471;
+	const bool bServeHttp = FParse::Param(*Params, TEXT("http")) || FParse::Value(*Params, TEXT("http="), Port);
+	TSharedPtr<IHttpRouter> Router;
+	TArray<FHttpRouteHandle> Routes;
+	if (bServeHttp)
+	{
+		Router = FHttpServerModule::Get().GetHttpRouter(Port);
+		for (const FString& ModelPath : ModelPaths)
+		{
+			Routes.Add(Router->BindRoute(FHttpPath(TEXT("/") + FPaths::GetCleanFilename(ModelPath)), EHttpServerRequestVerbs::VERB_GET,
+				[ModelPath](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+				{
+					TArray<uint8> Data;
+					FFileHelper::LoadFileToArray(Data, *ModelPath);
+					OnComplete(FHttpServerResponse::Create(MoveTemp(Data), TEXT("application/octet-stream")));
+					return true;
+				}));
+		}
+		FHttpServerModule::Get().StartAllListeners();
+	}
+
+	// transient world for spawning actors and creating their sections
+	UWorld* World = nullptr;
+	if (!FParse::Param(*Params, TEXT("nospawn")))
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("BIMBenchmark"));
+		GEngine->CreateNewWorldContext(EWorldType::Game).SetCurrentWorld(World);
+	}
+
+	TArray<FBenchmarkRow> Rows;
+	for (const FString& ModelPath : ModelPaths)
+	{
+		FBenchmarkRow& Row = Rows.AddDefaulted_GetRef();
+		Row.Model = FPaths::GetCleanFilename(ModelPath);
+		const FString Url = bServeHttp ? FString::Printf(TEXT("http://127.0.0.1:%d/%s"), Port, *Row.Model) : FString();
+
+		UE_LOG(LogAssimp, Display, TEXT("Benchmarking %s"), *Row.Model)
+		const bool bContinue = RunModel(ModelPath, Url, Settings, World, Row);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		if (!bContinue) break;
+	}
+
+	if (World)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+	if (Router.IsValid())
+	{
+		for (const FHttpRouteHandle& Route : Routes)
+		{
+			Router->UnbindRoute(Route);
+		}
+		FHttpServerModule::Get().StopAllListeners();
+	}
+
+	WriteResults(OutputDir / FString::Printf(TEXT("Results-%s"), *FDateTime::Now().ToString()), Rows);
+	return Rows.ContainsByPredicate([](const FBenchmarkRow& Row) { return !Row.bSucceeded; }) ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMDownload.h"
+
+#include "DXFRuntimeImporter.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpResponse.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+
+// bytes requested per ranged request, and so the most response data held in memory at once
+#define DOWNLOAD_CHUNK_SIZE (8 * 1024 * 1024)
+
+// times a download starts over because the file changed on the server, before giving up
+#define DOWNLOAD_MAX_RESTARTS 3
+
+void FBIMDownload::Start(const FString& Url, const FString& FilePath, FOnComplete OnComplete, const FString& CurrentVersion)
+{
+	TSharedRef<FBIMDownload, ESPMode::ThreadSafe> Download = MakeShareable(new FBIMDownload(Url, FilePath, MoveTemp(OnComplete), CurrentVersion));
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+	Download->File.Reset(PlatformFile.OpenWrite(*FilePath));
+	if (!Download->File.IsValid())
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Could not open %s for writing"), *FilePath)
+		Download->Finish(EBIMDownloadResult::Failed);
+		return;
+	}
+
+	Download->RequestChunk();
+}
+
+void FBIMDownload::FetchVersion(const FString& Url, TFunction<void(const FString& Version)> OnVersion)
+{
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+	Request->OnProcessRequestComplete().BindLambda([OnVersion](FHttpRequestPtr Req, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		FString Version;
+		if (bWasSuccessful && Response.IsValid() && EHttpResponseCodes::IsOk(Response->GetResponseCode()))
+		{
+			Version = GetVersion(Response);
+		}
+		OnVersion(Version);
+	});
+	Request->SetVerb(TEXT("HEAD"));
+	Request->SetURL(Url);
+	Request->ProcessRequest();
+}
+
+FBIMDownload::FBIMDownload(const FString& InUrl, const FString& InFilePath, FOnComplete InOnComplete, const FString& InCurrentVersion)
+	: Url(InUrl), FilePath(InFilePath), OnComplete(MoveTemp(InOnComplete)), CurrentVersion(InCurrentVersion)
+{
+}
+
+FString FBIMDownload::GetVersion(FHttpResponsePtr Response)
+{
+	const FString ETag = Response->GetHeader(TEXT("ETag"));
+	return ETag.IsEmpty() ? Response->GetHeader(TEXT("Last-Modified")) : ETag;
+}
+
+FBIMDownload::~FBIMDownload()
+{
+}
+
+void FBIMDownload::RequestChunk()
+{
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+
+	// the request holds the download until its response is handled
+	TSharedRef<FBIMDownload, ESPMode::ThreadSafe> This = AsShared();
+	Request->OnProcessRequestComplete().BindLambda([This](FHttpRequestPtr Req, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		This->OnChunkReceived(Req, Response, bWasSuccessful);
+	});
+	Request->SetVerb(TEXT("GET"));
+	Request->SetURL(Url);
+	Request->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), Offset, Offset + DOWNLOAD_CHUNK_SIZE - 1));
+
+	// ETags are quoted (and maybe weak), Last-Modified is an HTTP date. Anything else is sent unconditionally
+	FDateTime LastModified;
+	if (Offset == 0 && (CurrentVersion.StartsWith(TEXT("\"")) || CurrentVersion.StartsWith(TEXT("W/"))))
+	{
+		Request->SetHeader(TEXT("If-None-Match"), CurrentVersion);
+	}
+	else if (Offset == 0 && FDateTime::ParseHttpDate(CurrentVersion, LastModified))
+	{
+		Request->SetHeader(TEXT("If-Modified-Since"), CurrentVersion);
+	}
+
+	// later chunks must come from the version of the first one: the server sends the whole new file otherwise.
+	// Weak ETags can't be used for ranges, their responses are compared in OnChunkReceived
+	if (Offset > 0 && !Version.IsEmpty() && !Version.StartsWith(TEXT("W/")))
+	{
+		Request->SetHeader(TEXT("If-Range"), Version);
+	}
+	Request->ProcessRequest();
+}
+
+void FBIMDownload::OnChunkReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+{
+	if (!bWasSuccessful || !Response.IsValid())
+	{
+		UE_LOG(LogAssimp, Warning, TEXT("Download of %s failed at byte %lld"), *Url, Offset)
+		Finish(EBIMDownloadResult::Failed);
+		return;
+	}
+
+	const int32 Code = Response->GetResponseCode();
+	const TArray<uint8>& Content = Response->GetContent();
+
+	// only the first request is conditional
+	if (Code == 304 && Offset == 0)
+	{
+		Version = CurrentVersion;
+		Finish(EBIMDownloadResult::NotModified);
+		return;
+	}
+
+	// range past the end: the previous chunk ended exactly on the file size
+	if (Code == 416 && Offset > 0)
+	{
+		Finish(EBIMDownloadResult::Downloaded);
+		return;
+	}
+
+	// 200 means the server ignored the range (or If-Range failed) and sent the whole file
+	if ((Code != 206 && Code != 200) || Content.Num() == 0)
+	{
+		UE_LOG(LogAssimp, Warning, TEXT("Download of %s failed with HTTP %d"), *Url, Code)
+		Finish(EBIMDownloadResult::Failed);
+		return;
+	}
+
+	// the file was republished since the first chunk: start over rather than stitch two versions together
+	const FString ResponseVersion = GetVersion(Response);
+	const bool bChanged = Offset > 0 && (Code == 200 || (!Version.IsEmpty() && !ResponseVersion.IsEmpty() && ResponseVersion != Version));
+	if (bChanged)
+	{
+		if (!Restart())
+		{
+			Finish(EBIMDownloadResult::Failed);
+			return;
+		}
+
+		// a full response is the new version already, a range of it is requested again from the start
+		if (Code != 200)
+		{
+			RequestChunk();
+			return;
+		}
+	}
+
+	if (Offset == 0)
+	{
+		Version = ResponseVersion;
+	}
+
+	if (!File->Write(Content.GetData(), Content.Num()))
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Could not write to %s"), *FilePath)
+		Finish(EBIMDownloadResult::Failed);
+		return;
+	}
+	Offset += Content.Num();
+
+	if (Code == 200)
+	{
+		Finish(EBIMDownloadResult::Downloaded);
+		return;
+	}
+
+	// Content-Range: bytes <first>-<last>/<total>
+	if (TotalSize < 0)
+	{
+		FString Left, Total;
+		if (Response->GetHeader(TEXT("Content-Range")).Split(TEXT("/"), &Left, &Total) && Total != TEXT("*"))
+		{
+			TotalSize = FCString::Atoi64(*Total);
+		}
+	}
+
+	// unknown size: keep going until a short chunk
+	const bool bDone = TotalSize >= 0 ? Offset >= TotalSize : Content.Num() < DOWNLOAD_CHUNK_SIZE;
+	if (bDone)
+	{
+		Finish(EBIMDownloadResult::Downloaded);
+	}
+	else
+	{
+		RequestChunk();
+	}
+}
+
+bool FBIMDownload::Restart()
+{
+	if (++Restarts > DOWNLOAD_MAX_RESTARTS)
+	{
+		UE_LOG(LogAssimp, Warning, TEXT("Download of %s failed, the file keeps changing on the server"), *Url)
+		return false;
+	}
+	UE_LOG(LogAssimp, Log, TEXT("%s changed on the server during the download, starting over"), *Url)
+
+	File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*FilePath));
+	if (!File.IsValid())
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Could not open %s for writing"), *FilePath)
+		return false;
+	}
+
+	Offset = 0;
+	TotalSize = -1;
+	Version.Empty();
+	return true;
+}
+
+void FBIMDownload::Finish(EBIMDownloadResult Result)
+{
+	File.Reset();
+	if (Result != EBIMDownloadResult::Downloaded)
+	{
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+	}
+
+	if (OnComplete)
+	{
+		OnComplete(Result, Version);
+		OnComplete = nullptr;
+	}
+}
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpRequest.h"
+
+class IFileHandle;
+
+enum class EBIMDownloadResult : uint8
+{
+	Failed,
+	Downloaded,
+
+	// the server still has the version the download was conditional on, nothing was written
+	NotModified
+};
+
+/**
+ * Downloads a file over HTTP straight to disk, one ranged request per chunk, so at most one chunk
+ * is held in memory. Servers that ignore ranges send the whole body in one response, which is
+ * written out and released before the import starts. Game thread only
+ */
+class FBIMDownload : public TSharedFromThis<FBIMDownload, ESPMode::ThreadSafe>
+{
+public:
+	// called on the game thread with the outcome and the server's version of the file (empty if unknown),
+	// the file is left in place once downloaded
+	typedef TFunction<void(EBIMDownloadResult Result, const FString& Version)> FOnComplete;
+
+	/**
+	 * Start downloading Url to FilePath (overwritten). The download keeps itself alive until OnComplete.
+	 * With a CurrentVersion (as reported by FetchVersion), the request is conditional and nothing is downloaded
+	 * if the server still has that version
+	 */
+	static void Start(const FString& Url, const FString& FilePath, FOnComplete OnComplete, const FString& CurrentVersion = FString());
+
+	/**
+	 * Ask the server for the version of Url (ETag, or Last-Modified) with a HEAD request.
+	 * OnVersion gets an empty string if the server reports neither
+	 */
+	static void FetchVersion(const FString& Url, TFunction<void(const FString& Version)> OnVersion);
+
+	~FBIMDownload();
+
+private:
+	FBIMDownload(const FString& InUrl, const FString& InFilePath, FOnComplete InOnComplete, const FString& InCurrentVersion);
+
+	// ETag of a response, or its Last-Modified date. Empty if it has neither
+	static FString GetVersion(FHttpResponsePtr Response);
+
+	// request the chunk starting at Offset
+	void RequestChunk();
+
+	void OnChunkReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+
+	// truncate the file to download it again from the start, false once restarted too often
+	bool Restart();
+
+	// close the file (deleted unless downloaded) and report
+	void Finish(EBIMDownloadResult Result);
+
+	FString Url;
+	FString FilePath;
+	FOnComplete OnComplete;
+
+	// version the first request is conditional on, and the version the server answered with
+	FString CurrentVersion;
+	FString Version;
+
+	TUniquePtr<IFileHandle> File;
+
+	// bytes written so far, and total size once the server told us (-1 before)
+	int64 Offset = 0;
+	int64 TotalSize = -1;
+	int32 Restarts = 0;
+};
@@ -0,0 +1,333 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMImportPipeline.h"
+
+#include "DXFRuntimeImporter.h"
+#include "assimp/config.h"
+#include "assimp/Importer.hpp"
+#include "assimp/material.h"
+#include "assimp/scene.h"
+#include "Async/ParallelFor.h"
+#include "Hash/CityHash.h"
+#include "HAL/PlatformTime.h"
+#include "BIMImportProfile.h"
+#include "BIMImporterStats.h"
+#include "BIMMeshActor.h"
+#include "BIMMeshClusters.h"
+#include "BIMPointCloudActor.h"
+#include "BIMPolyLineActor.h"
+
+const aiScene* FBIMImportPipeline::ReadScene(Assimp::Importer* Imp, const void* Buffer, const size_t Length, const EBIMImportProfile Profile, const FString& Source)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMReadScene);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_ReadScene);
+
+	const FBIMImportProfile Steps = FBIMImportProfile::Get(Profile);
+	Imp->SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, Steps.SplitVertexLimit);
+	Imp->SetPropertyInteger(AI_CONFIG_PP_SLM_TRIANGLE_LIMIT, Steps.SplitTriangleLimit);
+
+	// the importer owns (and deletes) its progress handler
+	FBIMImportTimer* Timer = new FBIMImportTimer();
+	Imp->SetProgressHandler(Timer);
+	
+	UE_LOG(LogAssimp, Log, TEXT("Import Begin (%s)"), *UEnum::GetValueAsString(FBIMImportProfile::Resolve(Profile)))
+	// have to provide "glb" as hint to import GLTF files for some reason.
+	// DXF files still work given "glb" as hint, since importer falls back to signature based detection
+	double Start = FPlatformTime::Seconds();
+	const aiScene* Scene = Imp->ReadFileFromMemory(Buffer, Length, 0, "glb");
+	Timer->SetReadSeconds(FPlatformTime::Seconds() - Start);
+
+	// one step at a time, in assimp's order, to time each of them by name
+	for (const TPair<unsigned int, const TCHAR*>& Step : Steps.GetSteps())
+	{
+		if (!Scene) break;
+
+		Start = FPlatformTime::Seconds();
+		Scene = Imp->ApplyPostProcessing(Step.Key);
+		Timer->AddStep(Step.Value, FPlatformTime::Seconds() - Start);
+	}
+	UE_LOG(LogAssimp, Log, TEXT("Import End"))
+	Timer->Log(Source);
+
+	return Scene;
+}
+
+namespace
+{
+	// Layer names and combinations of them, deduplicated while sorting meshes
+	struct FCategoryBuilder
+	{
+		FBIMCategories& Categories;
+		TMap<FString, int32> NameIndices;
+		TMap<FString, int32> SetIndices;
+
+		int32 AddName(const FString& Name)
+		{
+			if (const int32* Found = NameIndices.Find(Name))
+			{
+				return *Found;
+			}
+			return NameIndices.Add(Name, Categories.Names.Add(Name));
+		}
+
+		// Sorts Set, its indices as text are the key
+		int32 AddSet(TArray<int32>& Set)
+		{
+			Set.Sort();
+			FString Key;
+			for (const int32 Index : Set)
+			{
+				Key += FString::Printf(TEXT("%d,"), Index);
+			}
+			if (const int32* Found = SetIndices.Find(Key))
+			{
+				return *Found;
+			}
+			return SetIndices.Add(Key, Categories.Sets.Add(Set));
+		}
+	};
+}
+
+void FBIMImportPipeline::SortMeshes(FBIMImportResult& Result)
+{
+	// group nodes above every mesh. The root stands for the file, and leaf nodes usually for single elements
+	FCategoryBuilder Builder{ Result.Categories };
+	TArray<TArray<int32>> MeshGroups;
+	MeshGroups.SetNum(Result.Scene->mNumMeshes);
+	TArray<TPair<const aiNode*, TArray<int32>>> Nodes;
+	if (Result.Scene->mRootNode)
+	{
+		Nodes.Emplace(Result.Scene->mRootNode, TArray<int32>());
+	}
+	while (Nodes.Num() > 0)
+	{
+		TPair<const aiNode*, TArray<int32>> Node = Nodes.Pop(false);
+		if (Node.Key != Result.Scene->mRootNode && Node.Key->mNumChildren > 0)
+		{
+			Node.Value.AddUnique(Builder.AddName(UTF8_TO_TCHAR(Node.Key->mName.C_Str())));
+		}
+		for (unsigned int m = 0; m < Node.Key->mNumMeshes; m++)
+		{
+			for (const int32 Group : Node.Value)
+			{
+				MeshGroups[Node.Key->mMeshes[m]].AddUnique(Group);
+			}
+		}
+		for (unsigned int c = 0; c < Node.Key->mNumChildren; c++)
+		{
+			Nodes.Emplace(Node.Key->mChildren[c], Node.Value);
+		}
+	}
+
+	for (unsigned int i = 0; i < Result.Scene->mNumMeshes; i++)
+	{
+		aiMesh* Obj = Result.Scene->mMeshes[i];
+		const FString Name = UTF8_TO_TCHAR(Obj->mName.C_Str());
+
+		// DXF layers become mesh names
+		TArray<int32>& Set = MeshGroups[i];
+		Set.AddUnique(Builder.AddName(Name));
+
+		if (Obj->mPrimitiveTypes & aiPrimitiveType_LINE)
+		{
+			Result.LineObjs.Add(Obj);
+			Result.LineNames.Add(Name);
+			Result.Categories.LineSets.Add(Builder.AddSet(Set));
+		}
+		else if (Obj->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) // assume triangulated (via flags)
+		{
+			Result.MeshObjs.Add(Obj);
+			Result.MeshNames.Add(Name);
+			Result.Categories.MeshSets.Add(Builder.AddSet(Set));
+		}
+		else if (Obj->mPrimitiveTypes & aiPrimitiveType_POINT) // SortByPType keeps points in meshes of their own
+		{
+			Result.PointObjs.Add(Obj);
+			Result.PointNames.Add(Name);
+			Result.Categories.PointSets.Add(Builder.AddSet(Set));
+		}
+	}
+}
+
+namespace
+{
+	// Single element covering the whole LOD0 section (or every instance) of freshly built buffers, and every vertex of each LOD
+	void InitElement(FBIMRenderBuffers& Buffers, const int32 SourceIndex, const int32 CategorySet, const int32 NumInstances, const int32 NumSegments)
+	{
+		FBIMElementRange& Element = Buffers.Elements.AddDefaulted_GetRef();
+		Element.SourceIndex = SourceIndex;
+		Element.CategorySet = CategorySet;
+		Element.NumIndices = NumInstances > 0 ? NumInstances : (Buffers.LODs.Num() > 0 ? Buffers.LODs[0].Sections[0].Triangles.Num() : 0);
+		Element.NumSegments = NumSegments;
+		Element.Bounds = Buffers.Bounds;
+
+		for (FBIMMeshLOD& LOD : Buffers.LODs)
+		{
+			LOD.ElementVertices.Emplace(0, LOD.Sections[0].Positions.Num());
+		}
+	}
+
+	// Generated layer colors: hues a golden angle apart, so neighbouring hashes look different
+	FColor GetPaletteColor(const FString& Layer)
+	{
+		const float Hue = FMath::Fmod((GetTypeHash(Layer) % 1024) * 0.618034f, 1.0f) * 360.0f;
+		return FLinearColor(Hue, 0.6f, 0.9f).HSVToLinearRGB().ToFColor(true);
+	}
+}
+
+FColor FBIMImportPipeline::GetElementColor(const aiScene* Scene, const aiMesh* AiMesh, const FBIMImportSettings& Settings)
+{
+	if (Settings.VertexColorMode == EBIMVertexColorMode::LayerPalette)
+	{
+		const FString Layer = UTF8_TO_TCHAR(AiMesh->mName.C_Str());
+		const FLinearColor* LayerColor = Settings.LayerColors.Find(Layer);
+		return LayerColor ? LayerColor->ToFColor(true) : GetPaletteColor(Layer);
+	}
+
+	// assimp colors are display values already, they are quantized as they are
+	if (AiMesh->HasVertexColors(0))
+	{
+		const aiColor4D& Color = AiMesh->mColors[0][0];
+		return FLinearColor(Color.r, Color.g, Color.b, Color.a).ToFColor(false);
+	}
+
+	aiColor4D Diffuse;
+	if (Scene && AiMesh->mMaterialIndex < Scene->mNumMaterials && aiGetMaterialColor(Scene->mMaterials[AiMesh->mMaterialIndex], AI_MATKEY_COLOR_DIFFUSE, &Diffuse) == AI_SUCCESS)
+	{
+		return FLinearColor(Diffuse.r, Diffuse.g, Diffuse.b, Diffuse.a).ToFColor(false);
+	}
+	return FColor::White;
+}
+
+uint64 FBIMImportPipeline::HashElement(const aiScene* Scene, const aiMesh* AiMesh, const FBIMImportSettings& Settings)
+{
+	// vertex streams as imported. SortByPType leaves a single face size per mesh, so indices alone describe the faces
+	uint64 Hash = CityHash64(reinterpret_cast<const char*>(AiMesh->mVertices), AiMesh->mNumVertices * sizeof(aiVector3D));
+	if (AiMesh->HasNormals())
+	{
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(AiMesh->mNormals), AiMesh->mNumVertices * sizeof(aiVector3D), Hash);
+	}
+	if (AiMesh->HasTextureCoords(0))
+	{
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(AiMesh->mTextureCoords[0]), AiMesh->mNumVertices * sizeof(aiVector3D), Hash);
+	}
+
+	TArray<uint32> Indices;
+	Indices.Reserve(AiMesh->mNumFaces * 3);
+	for (unsigned int f = 0; f < AiMesh->mNumFaces; f++)
+	{
+		Indices.Append(AiMesh->mFaces[f].mIndices, AiMesh->mFaces[f].mNumIndices);
+	}
+	Hash = CityHash64WithSeed(reinterpret_cast<const char*>(Indices.GetData()), Indices.Num() * sizeof(uint32), Hash);
+
+	// the material picks the section, and baked colors end up in the vertices
+	Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&AiMesh->mMaterialIndex), sizeof(AiMesh->mMaterialIndex), Hash);
+	if (Settings.VertexColorMode != EBIMVertexColorMode::None)
+	{
+		const FColor Color = GetElementColor(Scene, AiMesh, Settings);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Color), sizeof(FColor), Hash);
+	}
+	return Hash;
+}
+
+void FBIMImportPipeline::BuildBuffers(const aiScene* Scene, const TArray<aiMesh*>& MeshObjs, const TArray<aiMesh*>& LineObjs, const FBIMCategories& Categories, TArray<FBIMMeshBuffers>& MeshBuffers, TArray<FBIMLineBuffers>& LineBuffers, const FBIMImportSettings& Settings)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMBuildBuffers);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_BuildBuffers);
+
+	MeshBuffers.SetNum(MeshObjs.Num());
+	LineBuffers.SetNum(LineObjs.Num());
+
+	// one work item per assimp mesh, lines first since tubes are the expensive part
+	const int32 NumLines = LineObjs.Num();
+	const bool bBakeColors = Settings.VertexColorMode != EBIMVertexColorMode::None;
+	ParallelFor(NumLines + MeshObjs.Num(), [&](int32 Index)
+	{
+		if (Index < NumLines)
+		{
+			ABIMPolyLineActor::BuildLineBuffers(LineObjs[Index], Settings, LineBuffers[Index]);
+			InitElement(LineBuffers[Index], Index, FBIMCategories::GetSet(Categories.LineSets, Index), LineBuffers[Index].InstanceTransforms.Num(), LineBuffers[Index].SegmentPoints.Num() / 2);
+			LineBuffers[Index].Elements[0].GeometryHash = HashElement(Scene, LineObjs[Index], Settings);
+			if (bBakeColors)
+			{
+				BakeBIMColor(LineBuffers[Index], GetElementColor(Scene, LineObjs[Index], Settings));
+			}
+		}
+		else
+		{
+			ABIMMeshActor::BuildMeshBuffers(MeshObjs[Index - NumLines], Settings, MeshBuffers[Index - NumLines]);
+			InitElement(MeshBuffers[Index - NumLines], Index - NumLines, FBIMCategories::GetSet(Categories.MeshSets, Index - NumLines), 0, 0);
+			MeshBuffers[Index - NumLines].Elements[0].GeometryHash = HashElement(Scene, MeshObjs[Index - NumLines], Settings);
+			if (bBakeColors)
+			{
+				BakeBIMColor(MeshBuffers[Index - NumLines], GetElementColor(Scene, MeshObjs[Index - NumLines], Settings));
+			}
+		}
+	});
+
+	if (Settings.bMergeMeshes)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(BIM_MergeClusters);
+		FBIMMeshClusters::Merge(MeshBuffers, Settings.ClusterCellSize, Settings.ClusterVertexBudget);
+		FBIMMeshClusters::Merge(LineBuffers, Settings.ClusterCellSize, Settings.ClusterVertexBudget);
+	}
+}
+
+void FBIMImportPipeline::BuildPointBuffers(const TArray<aiMesh*>& PointObjs, const FBIMCategories& Categories, TArray<FBIMPointBuffers>& PointBuffers, const FBIMImportSettings& Settings)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMBuildBuffers);
+
+	PointBuffers.Reset();
+	if (PointObjs.Num() > 0)
+	{
+		ABIMPointCloudActor::BuildPointBuffers(PointObjs, Categories.PointSets, Settings, PointBuffers);
+	}
+}
+
+void FBIMImportPipeline::CountGeometry(FBIMImportResult& Result)
+{
+	FBIMImportReport& Report = Result.Report;
+	Report.bFromCache = Result.bFromCache;
+	Report.Meshes = Result.MeshNames.Num();
+	Report.Lines = Result.LineNames.Num();
+	Report.PointClouds = Result.PointNames.Num();
+	Report.Vertices = 0;
+	Report.Triangles = 0;
+	Report.Segments = 0;
+	Report.Points = 0;
+	Report.TrianglesSkipped = 0;
+
+	auto CountLOD0 = [&Report](const FBIMRenderBuffers& Buffers)
+	{
+		if (Buffers.LODs.Num() == 0) return;
+		for (const FBIMMeshSection& Section : Buffers.LODs[0].Sections)
+		{
+			Report.Vertices += Section.Positions.Num();
+			Report.Triangles += Section.Triangles.Num() / 3;
+		}
+	};
+
+	for (const FBIMMeshBuffers& Buffers : Result.MeshBuffers)
+	{
+		CountLOD0(Buffers);
+		Report.TrianglesSkipped += Buffers.TrianglesSkipped;
+	}
+	for (const FBIMLineBuffers& Buffers : Result.LineBuffers)
+	{
+		CountLOD0(Buffers);
+		Report.Segments += Buffers.SegmentPoints.Num() / 2;
+	}
+	for (const FBIMPointBuffers& Buffers : Result.PointBuffers)
+	{
+		Report.Points += Buffers.NumPoints();
+	}
+
+	// proxies are not part of the scene's geometry, they only stand in for it
+	Report.Proxies = Result.ProxyBuffers.Num();
+	Report.ProxyTriangles = 0;
+	for (const FBIMProxyBuffers& Buffers : Result.ProxyBuffers)
+	{
+		Report.ProxyTriangles += Buffers.LODs[0].Sections[0].Triangles.Num() / 3;
+	}
+}
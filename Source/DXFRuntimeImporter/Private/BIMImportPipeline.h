@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMMeshData.h"
+#include "BIMImportSettings.h"
+
+/**
+ * Stages of the import that run before any actor exists: parsing, sorting and building render buffers.
+ * Shared by UBIMScene and the benchmark commandlet. Safe to call from any thread
+ */
+class FBIMImportPipeline
+{
+public:
+	/**
+	 * Import a file in memory with the postprocessing steps of Profile. The scene is owned by Imp,
+	 * whose progress handler is the FBIMImportTimer of this read
+	 */
+	static const aiScene* ReadScene(Assimp::Importer* Imp, const void* Buffer, const size_t Length, const EBIMImportProfile Profile, const FString& Source);
+
+	/**
+	 * Sort the meshes of Result.Scene into lines, triangle meshes and points, with their names and layers
+	 */
+	static void SortMeshes(FBIMImportResult& Result);
+
+	/**
+	 * Build render buffers of every mesh and line of Scene in parallel, with baked colors and merged into clusters
+	 * if the settings ask for it. Buffers are relative to their own origin, so they don't depend on the scene reference.
+	 * Clusters only merge meshes with the same layers
+	 */
+	static void BuildBuffers(const aiScene* Scene, const TArray<aiMesh*>& MeshObjs, const TArray<aiMesh*>& LineObjs, const FBIMCategories& Categories, TArray<FBIMMeshBuffers>& MeshBuffers, TArray<FBIMLineBuffers>& LineBuffers, const FBIMImportSettings& Settings);
+
+	/**
+	 * Bucket the points of every point mesh into per-cell buffers (positions only, quantized if the settings ask for it)
+	 */
+	static void BuildPointBuffers(const TArray<aiMesh*>& PointObjs, const FBIMCategories& Categories, TArray<FBIMPointBuffers>& PointBuffers, const FBIMImportSettings& Settings);
+
+	/**
+	 * Color baked into the vertices of a mesh of Scene, following Settings.VertexColorMode
+	 */
+	static FColor GetElementColor(const aiScene* Scene, const aiMesh* AiMesh, const FBIMImportSettings& Settings);
+
+	/**
+	 * Hash of everything the buffers of a mesh of Scene are built from, so unchanged elements are recognized
+	 * in a new version of the file
+	 */
+	static uint64 HashElement(const aiScene* Scene, const aiMesh* AiMesh, const FBIMImportSettings& Settings);
+
+	/**
+	 * Count the source meshes, lines and point meshes, the LOD0 geometry of Result's buffers and its proxies into Result.Report
+	 */
+	static void CountGeometry(FBIMImportResult& Result);
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMImportProfile.h"
+
+#include "DXFRuntimeImporter.h"
+#include "BIMImporterConfig.h"
+#include "assimp/postprocess.h"
+
+// steps below this are not worth a log line
+#define MIN_LOGGED_STEP_SECONDS 0.0001
+
+EBIMImportProfile FBIMImportProfile::Resolve(EBIMImportProfile Profile)
+{
+	if (Profile != EBIMImportProfile::ProjectDefault) return Profile;
+
+	const EBIMImportProfile Default = GetDefault<UBIMImporterConfig>()->DefaultImportProfile;
+	return Default == EBIMImportProfile::ProjectDefault ? EBIMImportProfile::Quality : Default;
+}
+
+/*
+ * available Flags: https://assimp.sourceforge.net/lib_html/postprocess_8h.html
+ */
+FBIMImportProfile FBIMImportProfile::Get(EBIMImportProfile Profile)
+{
+	FBIMImportProfile Result;
+	switch (Resolve(Profile))
+	{
+	case EBIMImportProfile::FastPreview:
+		Result.Flags = (
+			aiProcess_Triangulate               |
+			aiProcess_SortByPType               |
+			aiProcess_SplitLargeMeshes
+		);
+		Result.SplitVertexLimit = MAX_uint16;
+		Result.SplitTriangleLimit = MAX_uint16;
+		break;
+	case EBIMImportProfile::Balanced:
+		Result.Flags = (
+			aiProcess_GenNormals                |
+			aiProcess_RemoveRedundantMaterials  |
+			aiProcess_Triangulate               |
+			aiProcess_SortByPType               |
+			aiProcess_FindDegenerates           |
+			aiProcess_FindInvalidData           |
+			aiProcess_OptimizeMeshes            |
+			aiProcess_SplitLargeMeshes
+		);
+		// sections fit 16-bit indices
+		Result.SplitVertexLimit = MAX_uint16;
+		Result.SplitTriangleLimit = MAX_uint16;
+		break;
+	default:
+		Result.Flags = (
+			aiProcess_GenNormals                |
+			aiProcess_RemoveRedundantMaterials  |
+			aiProcess_Triangulate               |
+			aiProcess_SortByPType               |
+			aiProcess_FindDegenerates           |
+			aiProcess_FindInvalidData           |
+			aiProcess_OptimizeGraph             |
+			aiProcess_OptimizeMeshes            |
+			aiProcess_SplitLargeMeshes
+		);
+		// assimp's defaults (AI_SLM_DEFAULT_MAX_*)
+		Result.SplitVertexLimit = 1000000;
+		Result.SplitTriangleLimit = 1000000;
+		break;
+	}
+	return Result;
+}
+
+TArray<TPair<unsigned int, const TCHAR*>> FBIMImportProfile::GetSteps() const
+{
+	// every flag the profiles above use, in the relative order of assimp's PostStepRegistry. Meshes are split
+	// after face normals made their vertices unique, so SplitLargeMeshes after GenNormals covers both its passes
+	static const TPair<unsigned int, const TCHAR*> Order[] = {
+		{aiProcess_RemoveRedundantMaterials, TEXT("RemoveRedundantMaterials")},
+		{aiProcess_OptimizeGraph, TEXT("OptimizeGraph")},
+		{aiProcess_OptimizeMeshes, TEXT("OptimizeMeshes")},
+		{aiProcess_FindDegenerates, TEXT("FindDegenerates")},
+		{aiProcess_Triangulate, TEXT("Triangulate")},
+		{aiProcess_SortByPType, TEXT("SortByPType")},
+		{aiProcess_FindInvalidData, TEXT("FindInvalidData")},
+		{aiProcess_GenNormals, TEXT("GenNormals")},
+		{aiProcess_SplitLargeMeshes, TEXT("SplitLargeMeshes")},
+	};
+
+	TArray<TPair<unsigned int, const TCHAR*>> Steps;
+	for (const TPair<unsigned int, const TCHAR*>& Step : Order)
+	{
+		if (Flags & Step.Key) Steps.Add(Step);
+	}
+	return Steps;
+}
+
+bool FBIMImportTimer::Update(float Percentage)
+{
+	// never cancel the import
+	return true;
+}
+
+double FBIMImportTimer::GetPostProcessSeconds() const
+{
+	double PostProcessSeconds = 0.0;
+	for (const TPair<FString, double>& Step : StepSeconds)
+	{
+		PostProcessSeconds += Step.Value;
+	}
+	return PostProcessSeconds;
+}
+
+void FBIMImportTimer::Log(const FString& Source) const
+{
+	UE_LOG(LogAssimp, Log, TEXT("Read %s in %.1f ms, post-processed in %.1f ms"), *Source, ReadSeconds * 1000.0, GetPostProcessSeconds() * 1000.0)
+	for (const TPair<FString, double>& Step : StepSeconds)
+	{
+		if (Step.Value >= MIN_LOGGED_STEP_SECONDS)
+		{
+			UE_LOG(LogAssimp, Verbose, TEXT("Post-process step %s: %.1f ms"), *Step.Key, Step.Value * 1000.0)
+		}
+	}
+}
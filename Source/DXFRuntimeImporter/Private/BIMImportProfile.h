@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMImportSettings.h"
+#include "assimp/ProgressHandler.hpp"
+
+/**
+ * Assimp post-processing flags and split limits of an import profile
+ */
+struct FBIMImportProfile
+{
+	unsigned int Flags = 0;
+
+	// AI_CONFIG_PP_SLM_* limits of aiProcess_SplitLargeMeshes
+	int32 SplitVertexLimit = 0;
+	int32 SplitTriangleLimit = 0;
+
+	/**
+	 * Replace ProjectDefault by the profile configured for the project
+	 */
+	static EBIMImportProfile Resolve(EBIMImportProfile Profile);
+
+	/**
+	 * Steps and limits of a (resolved) profile
+	 */
+	static FBIMImportProfile Get(EBIMImportProfile Profile);
+
+	/**
+	 * The flags set in Flags one by one, in the order assimp runs their steps, with the name they are timed by
+	 */
+	TArray<TPair<unsigned int, const TCHAR*>> GetSteps() const;
+};
+
+/**
+ * Progress handler holding the reading and post-processing times of one import. Assimp only reports registry
+ * indices of its steps, so ReadScene applies the profile's steps one at a time and records each by name
+ */
+class FBIMImportTimer : public Assimp::ProgressHandler
+{
+public:
+	virtual bool Update(float Percentage) override;
+
+	void SetReadSeconds(double Seconds)
+	{
+		ReadSeconds = Seconds;
+	}
+
+	void AddStep(const TCHAR* Name, double Seconds)
+	{
+		StepSeconds.Emplace(Name, Seconds);
+	}
+
+	// Seconds spent reading the file, before any post-processing
+	double GetReadSeconds() const
+	{
+		return ReadSeconds;
+	}
+
+	// Seconds spent in each post-processing step that ran, in the order they ran
+	const TArray<TPair<FString, double>>& GetStepSeconds() const
+	{
+		return StepSeconds;
+	}
+
+	// Seconds of all post-processing steps together
+	double GetPostProcessSeconds() const;
+
+	// Log the read time and the steps that took measurable time
+	void Log(const FString& Source) const;
+
+private:
+	double ReadSeconds = 0.0;
+	TArray<TPair<FString, double>> StepSeconds;
+};
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+// stat BIMImporter: cycle counters of every pipeline stage and memory held by imported scenes
+DECLARE_STATS_GROUP(TEXT("BIM Importer"), STATGROUP_BIMImporter, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Read and post-process"), STAT_BIMReadScene, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build buffers"), STAT_BIMBuildBuffers, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build spatial index"), STAT_BIMSpatialIndex, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build proxies"), STAT_BIMBuildProxies, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Cache load"), STAT_BIMCacheLoad, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Cache save"), STAT_BIMCacheSave, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create sections"), STAT_BIMCreateSections, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spawn actors"), STAT_BIMSpawn, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Stream tiles"), STAT_BIMStreaming, STATGROUP_BIMImporter, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply collision"), STAT_BIMCollision, STATGROUP_BIMImporter, );
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Source data"), STAT_BIMSourceMemory, STATGROUP_BIMImporter, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Render data"), STAT_BIMRenderMemory, STATGROUP_BIMImporter, );
+
+// csv profiler counters, captured with -csvCategories=BIMImporter
+CSV_DECLARE_CATEGORY_EXTERN(BIMImporter);
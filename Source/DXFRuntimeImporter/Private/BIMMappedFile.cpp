@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMMappedFile.h"
+
+#include "DXFRuntimeImporter.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+
+FBIMMappedFile::FBIMMappedFile()
+{
+}
+
+FBIMMappedFile::~FBIMMappedFile()
+{
+	Close();
+}
+
+bool FBIMMappedFile::Open(const FString& FilePath)
+{
+	Close();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (PlatformFile.FileSize(*FilePath) <= 0)
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Missing or empty file: %s"), *FilePath)
+		return false;
+	}
+
+	Handle.Reset(PlatformFile.OpenMapped(*FilePath));
+	if (Handle.IsValid())
+	{
+		Region.Reset(Handle->MapRegion(0, Handle->GetFileSize()));
+	}
+
+	if (Region.IsValid())
+	{
+		Data = Region->GetMappedPtr();
+		Size = Region->GetMappedSize();
+		return true;
+	}
+
+	// no mapping support (or mapping failed): read the file instead
+	Handle.Reset();
+	UE_LOG(LogAssimp, Log, TEXT("Could not map %s, loading it into memory"), *FilePath)
+	if (!FFileHelper::LoadFileToArray(Loaded, *FilePath))
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Could not read file: %s"), *FilePath)
+		return false;
+	}
+
+	Data = Loaded.GetData();
+	Size = Loaded.Num();
+	return true;
+}
+
+void FBIMMappedFile::Close()
+{
+	// the region has to be released before its file handle
+	Region.Reset();
+	Handle.Reset();
+	Loaded.Empty();
+
+	Data = nullptr;
+	Size = 0;
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * Read-only view of a whole file on disk, memory-mapped so the model is never copied into a buffer of ours.
+ * Falls back to loading the file on platforms without mapping support. Usable from any thread
+ */
+class FBIMMappedFile
+{
+public:
+	FBIMMappedFile();
+	~FBIMMappedFile();
+
+	/**
+	 * Map the file at FilePath. Returns false if it doesn't exist, is empty or can't be read
+	 */
+	bool Open(const FString& FilePath);
+
+	// Unmap the file (it can then be deleted)
+	void Close();
+
+	const uint8* GetData() const
+	{
+		return Data;
+	}
+
+	int64 GetSize() const
+	{
+		return Size;
+	}
+
+private:
+	TUniquePtr<IMappedFileHandle> Handle;
+	TUniquePtr<IMappedFileRegion> Region;
+
+	// only used when the platform can't map files
+	TArray<uint8> Loaded;
+
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+};
@@ -2,8 +2,11 @@
 
 
 #include "BIMMeshActor.h"
+#include "Engine/CollisionProfile.h"
 #include "Providers/RuntimeMeshProviderStatic.h"
 #include "DXFRuntimeImporter.h"
+#include "BIMMeshSimplifier.h"
+#include "BIMImporterStats.h"
 
 // Sets default values
 ABIMMeshActor::ABIMMeshActor()
@@ -18,56 +21,80 @@ void ABIMMeshActor::GenerateMesh(aiMesh* AiMesh)
 	// if null argument or base mesh already defined
 	if (!AiMesh || BaseMesh) return;
 
-	// Clear RMC
-	GetRuntimeMeshComponent()->Initialize(StaticProvider);
-	StaticProvider->ClearSection(0, 0);
+	FBIMMeshBuffers Buffers;
+	BuildMeshBuffers(AiMesh, FBIMImportSettings(), Buffers);
+	CreateMeshFromBuffers(Buffers, AiMesh);
+	PlaceAtReference(FBIMOrigin::FromUTM(RefEasting, RefNorthing, RefAltitude));
+}
 
-	// reserve buffers
-	TArray<FVector> Positions;
-	TArray<FVector> Normals;
-	TArray<FRuntimeMeshTangent> Tangents;
-	TArray<FVector2D> TexCoords;
-	TArray<int32> Triangles;
+void ABIMMeshActor::BuildMeshBuffers(const aiMesh* AiMesh, const FBIMImportSettings& Settings, FBIMMeshBuffers& OutBuffers)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_BuildMeshBuffers);
+
+	// vertices are stored relative to the mesh center, computed in double precision
+	const FBIMOrigin MeshOrigin = FBIMOrigin::FromMeshBounds(AiMesh);
+	OutBuffers.Origin = MeshOrigin;
 	
-	Positions.AddUninitialized(AiMesh->mNumVertices);
-	Normals.AddUninitialized(AiMesh->mNumVertices);
-	Tangents.AddUninitialized(AiMesh->mNumVertices);
-	TexCoords.AddUninitialized(AiMesh->mNumVertices);
+	FBIMMeshLOD& LOD0 = OutBuffers.LODs.AddDefaulted_GetRef();
+	LOD0.ScreenSize = Settings.MeshLODs.Num() > 0 ? Settings.MeshLODs[0].ScreenSize : 1.0f;
+	FBIMMeshSection& Section = LOD0.Sections.AddDefaulted_GetRef();
 	
-	// set positions, normals, tangents, UV
+	TArray<FVector>& Positions = Section.Positions;
+	TArray<FPackedNormal>& Normals = Section.Normals;
+	TArray<FPackedNormal>& Tangents = Section.Tangents;
+	TArray<FVector2DHalf>& TexCoords = Section.TexCoords;
+	TArray<FColor>& Colors = Section.Colors;
+	TArray<int32>& Triangles = Section.Triangles;
+
+	// streams the source doesn't have stay empty
+	const bool bHasNormals = AiMesh->HasNormals();
+	const bool bHasTangents = bHasNormals && AiMesh->HasTangentsAndBitangents();
+	const bool bHasTexCoords = AiMesh->HasTextureCoords(0);
+	const bool bHasColors = Settings.VertexColorMode == EBIMVertexColorMode::SourceColors && AiMesh->HasVertexColors(0);
+	
+	// reserve buffers
+	Positions.SetNumUninitialized(AiMesh->mNumVertices);
+	Normals.SetNumUninitialized(bHasNormals ? AiMesh->mNumVertices : 0);
+	Tangents.SetNumUninitialized(bHasTangents ? AiMesh->mNumVertices : 0);
+	TexCoords.SetNumUninitialized(bHasTexCoords ? AiMesh->mNumVertices : 0);
+	Colors.SetNumUninitialized(bHasColors ? AiMesh->mNumVertices : 0);
+	Triangles.Reserve(AiMesh->mNumFaces * 3);
+	
+	// set positions, normals, tangents, UV, colors
 	for (unsigned int v = 0; v < AiMesh->mNumVertices; v++)
 	{
-		if (AiMesh->HasPositions())
-		{
-			// centimeter scaling
-			Positions[v] = FVector(
-				(AiMesh->mVertices[v].y - RefNorthing) * 100.0f,
-				(AiMesh->mVertices[v].x - RefEasting) * 100.0f,
-				(AiMesh->mVertices[v].z - RefAltitude) * 100.0f
-			);	
-		}
+		// centimeter scaling
+		Positions[v] = MeshOrigin.ToLocal(AiMesh->mVertices[v].x, AiMesh->mVertices[v].y, AiMesh->mVertices[v].z);
 
-		if (AiMesh->HasNormals())
+		if (bHasNormals)
 		{
-			Normals[v] = FVector(
+			Normals[v] = FPackedNormal(FVector(
 				AiMesh->mNormals[v].y,
 				AiMesh->mNormals[v].x,
 				AiMesh->mNormals[v].z
-			);	
+			));
+		}
+
+		if (bHasTangents)
+		{
+			const FVector TangentX(AiMesh->mTangents[v].y, AiMesh->mTangents[v].x, AiMesh->mTangents[v].z);
+			const FVector TangentY(AiMesh->mBitangents[v].y, AiMesh->mBitangents[v].x, AiMesh->mBitangents[v].z);
+			const FVector TangentZ(AiMesh->mNormals[v].y, AiMesh->mNormals[v].x, AiMesh->mNormals[v].z);
+
+			// binormal sign in W, the binormal is rebuilt from the normal and tangent
+			const float BinormalSign = ((TangentZ ^ TangentX) | TangentY) < 0.0f ? -1.0f : 1.0f;
+			Tangents[v] = FPackedNormal(FVector4(TangentX, BinormalSign));
 		}
 
-		if (AiMesh->HasTangentsAndBitangents())
+		if (bHasTexCoords)
 		{
-			Tangents[v] = FVector(
-				AiMesh->mTangents[v].y,
-				AiMesh->mTangents[v].x,
-				AiMesh->mTangents[v].z
-			);
+			TexCoords[v] = FVector2DHalf(AiMesh->mTextureCoords[0][v].x, AiMesh->mTextureCoords[0][v].y);
 		}
 
-		if (AiMesh->mTextureCoords[0])
+		if (bHasColors)
 		{
-			// set UVs
+			const aiColor4D& Color = AiMesh->mColors[0][v];
+			Colors[v] = FLinearColor(Color.r, Color.g, Color.b, Color.a).ToFColor(false);
 		}
 	}
 
@@ -75,7 +102,7 @@ void ABIMMeshActor::GenerateMesh(aiMesh* AiMesh)
 	int TrianglesSkipped = 0;
 	for (unsigned int f = 0; f < AiMesh->mNumFaces; f++)
 	{
-		const aiFace Face = AiMesh->mFaces[f];
+		const aiFace& Face = AiMesh->mFaces[f];
 
 		// Unreal crashes if a triangle uses less than three distinct vertices
 		if (
@@ -88,20 +115,106 @@ void ABIMMeshActor::GenerateMesh(aiMesh* AiMesh)
 			continue;
 		}
 
-		Triangles.Push(Face.mIndices[0]);
-		Triangles.Push(Face.mIndices[1]);
-		Triangles.Push(Face.mIndices[2]);
+		Triangles.Add(Face.mIndices[0]);
+		Triangles.Add(Face.mIndices[1]);
+		Triangles.Add(Face.mIndices[2]);
 	}
-	
-	UE_LOG(LogAssimp, Warning, TEXT("Triangles skipped: %d out of %d"), TrianglesSkipped, AiMesh->mNumFaces)
 
-	// Create RMC section
-	const TArray<FColor> EmptyColors{};
-	StaticProvider->CreateSectionFromComponents(0, 0, 0, Positions, Triangles, Normals, TexCoords, EmptyColors, Tangents, ERuntimeMeshUpdateFrequency::Infrequent, false);
+	// assimp keeps a vertex per face corner unless asked to join them
+	if (Settings.bWeldVertices)
+	{
+		WeldBIMSection(Section);
+	}
+
+	OutBuffers.TrianglesSkipped = TrianglesSkipped;
+	OutBuffers.MaterialIndex = AiMesh->mMaterialIndex;
+	OutBuffers.Bounds = FBox(Positions);
+	if (TrianglesSkipped > 0)
+	{
+		UE_LOG(LogAssimp, Verbose, TEXT("Triangles skipped: %d out of %d"), TrianglesSkipped, AiMesh->mNumFaces)
+	}
+
+	// Simplified LODs, each one from the previous. Stops once the simplifier can't reduce any further
+	const int32 NumTriangles = Triangles.Num() / 3;
+	for (int32 LODIndex = 1; LODIndex < Settings.MeshLODs.Num(); LODIndex++)
+	{
+		const FBIMMeshLODSettings& LODSettings = Settings.MeshLODs[LODIndex];
+		FBIMMeshLOD LOD;
+		LOD.ScreenSize = LODSettings.ScreenSize;
+
+		const int32 TargetTriangles = FMath::Max(1, FMath::RoundToInt(NumTriangles * LODSettings.TrianglePercent));
+		if (!FBIMMeshSimplifier::Simplify(OutBuffers.LODs.Last().Sections[0], TargetTriangles, LOD.Sections.AddDefaulted_GetRef()))
+		{
+			break;
+		}
+		OutBuffers.LODs.Add(MoveTemp(LOD));
+	}
+}
+
+void ABIMMeshActor::CreateMeshFromBuffers(const FBIMMeshBuffers& Buffers, aiMesh* AiMesh)
+{
+	// clusters, cache hits and released scenes have no base mesh, the render data is what marks a built actor
+	if (BaseMesh || RenderMemory > 0) return;
+
+	// Clear RMC
+	GetRuntimeMeshComponent()->Initialize(StaticProvider);
+	StaticProvider->ClearSection(0, 0);
+
+	// Create RMC sections of every LOD
+	CreateBIMSections(StaticProvider, Buffers.LODs);
 	StaticProvider->SetupMaterialSlot(0, TEXT("BIM Material"), Material);
+	LODSectionCounts.Reset();
+	for (const FBIMMeshLOD& LOD : Buffers.LODs)
+	{
+		LODSectionCounts.Add(LOD.Sections.Num());
+	}
+	RenderMemory = GetBIMRenderSize(Buffers.LODs);
+	INC_MEMORY_STAT_BY(STAT_BIMRenderMemory, RenderMemory);
+	ElementVertices.Init(Buffers);
 	
 	// Set base mesh for future reference (maybe)	
 	BaseMesh = AiMesh;
+	Origin = Buffers.Origin;
+}
+
+void ABIMMeshActor::BeginDestroy()
+{
+	DEC_MEMORY_STAT_BY(STAT_BIMRenderMemory, RenderMemory);
+	RenderMemory = 0;
+
+	Super::BeginDestroy();
+}
+
+void ABIMMeshActor::PlaceAtReference(const FBIMOrigin& Reference)
+{
+	const FVector Location = Origin - Reference;
+	if (GetActorLocation().Equals(Location)) return;
+
+	// runtime mesh actors are static by default, re-anchoring needs to move them
+	GetRootComponent()->SetMobility(EComponentMobility::Movable);
+	SetActorLocation(Location);
+}
+
+void ABIMMeshActor::SetCollisionMode(EBIMCollisionMode Mode)
+{
+	if (Mode == EBIMCollisionMode::None || LODSectionCounts.Num() == 0)
+	{
+		GetRuntimeMeshComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		return;
+	}
+
+	// the last LOD is the most decimated one
+	const int32 LODIndex = Mode == EBIMCollisionMode::Full ? 0 : LODSectionCounts.Num() - 1;
+	EnableBIMCollision(StaticProvider, LODIndex, LODSectionCounts[LODIndex]);
+	GetRuntimeMeshComponent()->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+}
+
+bool ABIMMeshActor::SetElementColors(const TArray<int32>& Elements, const FLinearColor& Color)
+{
+	if (ElementVertices.IsEmpty()) return false;
+
+	ElementVertices.SetColor(StaticProvider, Elements, Color.ToFColor(true));
+	return true;
 }
 
 void ABIMMeshActor::SetRefs(float Easting, float Northing, float Altitude)
@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMMeshClusters.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	// Append the elements of Src to Dest, padding with Default where only one side has a stream
+	template <typename T>
+	void AppendStream(TArray<T>& Dest, const TArray<T>& Src, const int32 DestVertices, const int32 SrcVertices, const T& Default)
+	{
+		if (Src.Num() != SrcVertices && Dest.Num() == 0) return;
+
+		while (Dest.Num() < DestVertices)
+		{
+			Dest.Add(Default);
+		}
+		if (Src.Num() == SrcVertices)
+		{
+			Dest.Append(Src);
+		}
+		else
+		{
+			for (int32 v = 0; v < SrcVertices; v++)
+			{
+				Dest.Add(Default);
+			}
+		}
+	}
+
+	// Offset moves Src vertices from their own origin to the one of Dest
+	void AppendSection(FBIMMeshSection& Dest, const FBIMMeshSection& Src, const FVector& Offset)
+	{
+		const int32 DestVertices = Dest.Positions.Num();
+		const int32 SrcVertices = Src.Positions.Num();
+
+		AppendStream(Dest.Normals, Src.Normals, DestVertices, SrcVertices, FPackedNormal(FVector::UpVector));
+		AppendStream(Dest.Tangents, Src.Tangents, DestVertices, SrcVertices, FPackedNormal(FVector4(FVector::ForwardVector, 1.0f)));
+		AppendStream(Dest.TexCoords, Src.TexCoords, DestVertices, SrcVertices, FVector2DHalf(0.0f, 0.0f));
+		AppendStream(Dest.Colors, Src.Colors, DestVertices, SrcVertices, FColor::White);
+		for (const FVector& Position : Src.Positions)
+		{
+			Dest.Positions.Add(Position + Offset);
+		}
+
+		const int32 FirstIndex = Dest.Triangles.Num();
+		Dest.Triangles.Append(Src.Triangles);
+		for (int32 i = FirstIndex; i < Dest.Triangles.Num(); i++)
+		{
+			Dest.Triangles[i] += DestVertices;
+		}
+	}
+
+	// Type specific parts of the merge
+	int32 BudgetCost(const FBIMMeshBuffers& Buffers)
+	{
+		return Buffers.LODs.Num() > 0 && Buffers.LODs[0].Sections.Num() > 0 ? Buffers.LODs[0].Sections[0].Positions.Num() : 0;
+	}
+
+	int32 BudgetCost(const FBIMLineBuffers& Buffers)
+	{
+		return Buffers.InstanceTransforms.Num() > 0 ? Buffers.InstanceTransforms.Num() : (Buffers.LODs.Num() > 0 && Buffers.LODs[0].Sections.Num() > 0 ? Buffers.LODs[0].Sections[0].Positions.Num() : 0);
+	}
+
+	// Base receives where the streams of Src start in Dest (first instance and first segment)
+	void AppendExtra(FBIMMeshBuffers& Dest, const FBIMMeshBuffers& Src, const FVector& Offset, FBIMElementRange& Base)
+	{
+		Dest.TrianglesSkipped += Src.TrianglesSkipped;
+	}
+
+	void AppendExtra(FBIMLineBuffers& Dest, const FBIMLineBuffers& Src, const FVector& Offset, FBIMElementRange& Base)
+	{
+		Base.FirstIndex = Dest.InstanceTransforms.Num();
+		for (const FTransform& Transform : Src.InstanceTransforms)
+		{
+			FTransform& Moved = Dest.InstanceTransforms.Add_GetRef(Transform);
+			Moved.AddToTranslation(Offset);
+		}
+
+		Base.FirstSegment = Dest.SegmentPoints.Num() / 2;
+		for (const FVector& Point : Src.SegmentPoints)
+		{
+			Dest.SegmentPoints.Add(Point + Offset);
+		}
+	}
+
+	// Size the streams AppendExtra fills for all Members at once
+	void ReserveExtra(FBIMMeshBuffers& Dest, const TArray<FBIMMeshBuffers>& Buffers, const TArray<int32>& Members)
+	{
+	}
+
+	void ReserveExtra(FBIMLineBuffers& Dest, const TArray<FBIMLineBuffers>& Buffers, const TArray<int32>& Members)
+	{
+		int32 NumInstances = 0;
+		int32 NumPoints = 0;
+		for (const int32 Index : Members)
+		{
+			NumInstances += Buffers[Index].InstanceTransforms.Num();
+			NumPoints += Buffers[Index].SegmentPoints.Num();
+		}
+		Dest.InstanceTransforms.Reserve(NumInstances);
+		Dest.SegmentPoints.Reserve(NumPoints);
+	}
+
+	// Group buffer indices by grid cell and combination of layers, and split the groups by vertex budget
+	template <typename BuffersType>
+	TArray<TArray<int32>> BuildClusters(const TArray<BuffersType>& Buffers, const float CellSize, const int32 VertexBudget)
+	{
+		TMap<TTuple<FIntVector, int32>, TArray<int32>> Cells;
+		for (int32 i = 0; i < Buffers.Num(); i++)
+		{
+			// cell of the absolute bounds center, in double precision
+			const FBIMOrigin& Origin = Buffers[i].Origin;
+			const FVector Center = Buffers[i].Bounds.IsValid ? Buffers[i].Bounds.GetCenter() : FVector::ZeroVector;
+			const FIntVector Cell(
+				static_cast<int32>(FMath::FloorToDouble((Origin.X + Center.X) / CellSize)),
+				static_cast<int32>(FMath::FloorToDouble((Origin.Y + Center.Y) / CellSize)),
+				static_cast<int32>(FMath::FloorToDouble((Origin.Z + Center.Z) / CellSize))
+			);
+			const int32 CategorySet = Buffers[i].Elements.Num() > 0 ? Buffers[i].Elements[0].CategorySet : INDEX_NONE;
+			Cells.FindOrAdd(MakeTuple(Cell, CategorySet)).Add(i);
+		}
+
+		TArray<TArray<int32>> Clusters;
+		for (TPair<TTuple<FIntVector, int32>, TArray<int32>>& Cell : Cells)
+		{
+			int32 ClusterCost = 0;
+			TArray<int32>* Cluster = nullptr;
+			for (const int32 Index : Cell.Value)
+			{
+				const int32 Cost = BudgetCost(Buffers[Index]);
+				if (!Cluster || ClusterCost + Cost > VertexBudget)
+				{
+					Cluster = &Clusters.AddDefaulted_GetRef();
+					ClusterCost = 0;
+				}
+				Cluster->Add(Index);
+				ClusterCost += Cost;
+			}
+		}
+		return Clusters;
+	}
+
+	template <typename BuffersType>
+	void MergeCluster(TArray<BuffersType>& Buffers, const TArray<int32>& Members, BuffersType& Out)
+	{
+		// nothing to merge, take the buffers over
+		if (Members.Num() == 1)
+		{
+			Out = MoveTemp(Buffers[Members[0]]);
+			return;
+		}
+
+		// actors render every section with the scene's single mesh (or line) material, so one section per LOD is
+		// all a cluster needs. Meshes without all LODs repeat their coarsest one
+		int32 NumLODs = 0;
+		for (const int32 Index : Members)
+		{
+			NumLODs = FMath::Max(NumLODs, Buffers[Index].LODs.Num());
+		}
+
+		// the cluster is anchored at its first member, the others are offset relative to it
+		Out.Origin = Buffers[Members[0]].Origin;
+		Out.MaterialIndex = Buffers[Members[0]].MaterialIndex;
+		Out.LODs.SetNum(NumLODs);
+		for (int32 LODIndex = 0; LODIndex < NumLODs; LODIndex++)
+		{
+			Out.LODs[LODIndex].Sections.SetNum(1);
+		}
+
+		// sized once from the summed members, streams still grow geometrically from there
+		int32 NumElements = 0;
+		TArray<int32> NumVertices;
+		TArray<int32> NumIndices;
+		NumVertices.SetNumZeroed(NumLODs);
+		NumIndices.SetNumZeroed(NumLODs);
+		for (const int32 Index : Members)
+		{
+			const BuffersType& Src = Buffers[Index];
+			NumElements += Src.Elements.Num();
+			for (int32 LODIndex = 0; LODIndex < NumLODs && Src.LODs.Num() > 0; LODIndex++)
+			{
+				for (const FBIMMeshSection& SrcSection : Src.LODs[FMath::Min(LODIndex, Src.LODs.Num() - 1)].Sections)
+				{
+					NumVertices[LODIndex] += SrcSection.Positions.Num();
+					NumIndices[LODIndex] += SrcSection.Triangles.Num();
+				}
+			}
+		}
+		ReserveExtra(Out, Buffers, Members);
+		Out.Elements.Reserve(NumElements);
+		for (int32 LODIndex = 0; LODIndex < NumLODs; LODIndex++)
+		{
+			Out.LODs[LODIndex].ElementVertices.Reserve(NumElements);
+			Out.LODs[LODIndex].Sections[0].Positions.Reserve(NumVertices[LODIndex]);
+			Out.LODs[LODIndex].Sections[0].Triangles.Reserve(NumIndices[LODIndex]);
+		}
+
+		for (const int32 Index : Members)
+		{
+			const BuffersType& Src = Buffers[Index];
+			const int32 SectionIndex = 0;
+			const FVector Offset = Src.Origin - Out.Origin;
+			FBIMElementRange Base;
+			AppendExtra(Out, Src, Offset, Base);
+			Out.Bounds += Src.Bounds.ShiftBy(Offset);
+
+			// section offsets at LOD0 for the element ranges, and vertex offsets at every LOD
+			TArray<int32> FirstIndices;
+			for (int32 LODIndex = 0; LODIndex < NumLODs && Src.LODs.Num() > 0; LODIndex++)
+			{
+				const FBIMMeshLOD& SrcLOD = Src.LODs[FMath::Min(LODIndex, Src.LODs.Num() - 1)];
+				FBIMMeshLOD& DestLOD = Out.LODs[LODIndex];
+				FBIMMeshSection& Dest = DestLOD.Sections[SectionIndex];
+				if (LODIndex < Src.LODs.Num())
+				{
+					DestLOD.ScreenSize = SrcLOD.ScreenSize;
+				}
+				
+				TArray<int32> FirstVertices;
+				for (const FBIMMeshSection& SrcSection : SrcLOD.Sections)
+				{
+					if (LODIndex == 0)
+					{
+						FirstIndices.Add(Dest.Triangles.Num());
+					}
+					FirstVertices.Add(Dest.Positions.Num());
+					AppendSection(Dest, SrcSection, Offset);
+				}
+
+				for (int32 ElementIndex = 0; ElementIndex < Src.Elements.Num(); ElementIndex++)
+				{
+					const int32 SrcSectionIndex = Src.Elements[ElementIndex].SectionIndex;
+					const FIntPoint Range = SrcLOD.ElementVertices.IsValidIndex(ElementIndex) ? SrcLOD.ElementVertices[ElementIndex] : FIntPoint::ZeroValue;
+					DestLOD.ElementVertices.Emplace(Range.X + (FirstVertices.IsValidIndex(SrcSectionIndex) ? FirstVertices[SrcSectionIndex] : 0), Range.Y);
+				}
+			}
+
+			for (const FBIMElementRange& Element : Src.Elements)
+			{
+				FBIMElementRange& Merged = Out.Elements.Add_GetRef(Element);
+				Merged.Bounds = Element.Bounds.ShiftBy(Offset);
+				Merged.FirstSegment += Base.FirstSegment;
+				if (Src.LODs.Num() > 0)
+				{
+					Merged.SectionIndex = SectionIndex;
+					Merged.FirstIndex += FirstIndices.IsValidIndex(Element.SectionIndex) ? FirstIndices[Element.SectionIndex] : 0;
+				}
+				else
+				{
+					Merged.FirstIndex += Base.FirstIndex;
+				}
+			}
+		}
+	}
+
+	template <typename BuffersType>
+	void MergeBuffers(TArray<BuffersType>& InOutBuffers, const float CellSize, const int32 VertexBudget)
+	{
+		const TArray<TArray<int32>> Clusters = BuildClusters(InOutBuffers, CellSize, VertexBudget);
+
+		// every buffer belongs to exactly one cluster, so clusters can be merged in parallel
+		TArray<BuffersType> Merged;
+		Merged.SetNum(Clusters.Num());
+		ParallelFor(Clusters.Num(), [&](int32 ClusterIndex)
+		{
+			MergeCluster(InOutBuffers, Clusters[ClusterIndex], Merged[ClusterIndex]);
+		});
+
+		InOutBuffers = MoveTemp(Merged);
+	}
+}
+
+void FBIMMeshClusters::Merge(TArray<FBIMMeshBuffers>& InOutBuffers, float CellSize, int32 VertexBudget)
+{
+	MergeBuffers(InOutBuffers, CellSize, VertexBudget);
+}
+
+void FBIMMeshClusters::Merge(TArray<FBIMLineBuffers>& InOutBuffers, float CellSize, int32 VertexBudget)
+{
+	MergeBuffers(InOutBuffers, CellSize, VertexBudget);
+}
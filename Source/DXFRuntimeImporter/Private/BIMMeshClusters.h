@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMMeshData.h"
+
+/**
+ * Merges per-mesh buffers into spatial clusters to cut actor and draw call counts. Buffers are grouped
+ * by the grid cell containing their bounds center and by their layers (so a cluster is shown or hidden as a
+ * whole when layers are toggled), split to respect a vertex budget and get a single
+ * section, since actors render with one material (per-element colors can be baked into vertices). Element ranges are
+ * carried over so every source mesh can still be resolved. Thread-safe
+ */
+class FBIMMeshClusters
+{
+public:
+	static void Merge(TArray<FBIMMeshBuffers>& InOutBuffers, float CellSize, int32 VertexBudget);
+	static void Merge(TArray<FBIMLineBuffers>& InOutBuffers, float CellSize, int32 VertexBudget);
+};
@@ -0,0 +1,323 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMMeshData.h"
+#include "BIMImporterStats.h"
+#include "Providers/RuntimeMeshProviderStatic.h"
+#include "assimp/mesh.h"
+#include "Misc/Crc.h"
+
+FBIMOrigin FBIMOrigin::FromMeshBounds(const aiMesh* AiMesh)
+{
+	if (!AiMesh || AiMesh->mNumVertices == 0)
+	{
+		return FBIMOrigin();
+	}
+
+	double Min[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+	double Max[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+	for (unsigned int v = 0; v < AiMesh->mNumVertices; v++)
+	{
+		const aiVector3D& Vertex = AiMesh->mVertices[v];
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			Min[Axis] = FMath::Min<double>(Min[Axis], Vertex[Axis]);
+			Max[Axis] = FMath::Max<double>(Max[Axis], Vertex[Axis]);
+		}
+	}
+
+	return FromUTM(0.5 * (Min[0] + Max[0]), 0.5 * (Min[1] + Max[1]), 0.5 * (Min[2] + Max[2]));
+}
+
+SIZE_T FBIMCategories::GetAllocatedSize() const
+{
+	SIZE_T Size = Names.GetAllocatedSize() + Sets.GetAllocatedSize() + MeshSets.GetAllocatedSize() + LineSets.GetAllocatedSize() + PointSets.GetAllocatedSize();
+	for (const FString& Name : Names)
+	{
+		Size += Name.GetAllocatedSize();
+	}
+	for (const TArray<int32>& Set : Sets)
+	{
+		Size += Set.GetAllocatedSize();
+	}
+	return Size;
+}
+
+namespace
+{
+	// Every stream of one vertex, missing streams are zero
+	struct FWeldKey
+	{
+		FVector Position;
+		uint32 Normal;
+		uint32 Tangent;
+		uint32 TexCoord;
+		uint32 Color;
+
+		bool operator==(const FWeldKey& Other) const
+		{
+			return Position == Other.Position && Normal == Other.Normal && Tangent == Other.Tangent && TexCoord == Other.TexCoord && Color == Other.Color;
+		}
+
+		friend uint32 GetTypeHash(const FWeldKey& Key)
+		{
+			return FCrc::MemCrc32(&Key, sizeof(FWeldKey));
+		}
+	};
+}
+
+void WeldBIMSection(FBIMMeshSection& Section)
+{
+	const int32 NumVertices = Section.Positions.Num();
+	const bool bHasNormals = Section.Normals.Num() == NumVertices;
+	const bool bHasTangents = Section.Tangents.Num() == NumVertices;
+	const bool bHasTexCoords = Section.TexCoords.Num() == NumVertices;
+	const bool bHasColors = Section.Colors.Num() == NumVertices;
+
+	TMap<FWeldKey, int32> Welded;
+	Welded.Reserve(NumVertices);
+	TArray<int32> Remap;
+	Remap.SetNumUninitialized(NumVertices);
+
+	// compact in place: unique vertices are moved down to their new index
+	int32 NumUnique = 0;
+	for (int32 v = 0; v < NumVertices; v++)
+	{
+		FWeldKey Key;
+		FMemory::Memzero(Key);
+		Key.Position = Section.Positions[v];
+		Key.Normal = bHasNormals ? Section.Normals[v].Vector.Packed : 0;
+		Key.Tangent = bHasTangents ? Section.Tangents[v].Vector.Packed : 0;
+		Key.TexCoord = bHasTexCoords ? *reinterpret_cast<const uint32*>(&Section.TexCoords[v]) : 0;
+		Key.Color = bHasColors ? Section.Colors[v].DWColor() : 0;
+
+		if (const int32* Found = Welded.Find(Key))
+		{
+			Remap[v] = *Found;
+			continue;
+		}
+
+		Welded.Add(Key, NumUnique);
+		Remap[v] = NumUnique;
+		Section.Positions[NumUnique] = Section.Positions[v];
+		if (bHasNormals) Section.Normals[NumUnique] = Section.Normals[v];
+		if (bHasTangents) Section.Tangents[NumUnique] = Section.Tangents[v];
+		if (bHasTexCoords) Section.TexCoords[NumUnique] = Section.TexCoords[v];
+		if (bHasColors) Section.Colors[NumUnique] = Section.Colors[v];
+		NumUnique++;
+	}
+
+	if (NumUnique == NumVertices) return;
+
+	Section.Positions.SetNum(NumUnique);
+	if (bHasNormals) Section.Normals.SetNum(NumUnique);
+	if (bHasTangents) Section.Tangents.SetNum(NumUnique);
+	if (bHasTexCoords) Section.TexCoords.SetNum(NumUnique);
+	if (bHasColors) Section.Colors.SetNum(NumUnique);
+	for (int32& Index : Section.Triangles)
+	{
+		Index = Remap[Index];
+	}
+}
+
+SIZE_T FBIMRenderBuffers::GetAllocatedSize() const
+{
+	SIZE_T Size = LODs.GetAllocatedSize() + Elements.GetAllocatedSize();
+	for (const FBIMMeshLOD& LOD : LODs)
+	{
+		Size += LOD.Sections.GetAllocatedSize() + LOD.ElementVertices.GetAllocatedSize();
+		for (const FBIMMeshSection& Section : LOD.Sections)
+		{
+			Size += Section.GetAllocatedSize();
+		}
+	}
+	return Size;
+}
+
+FVector FBIMPointBuffers::GetQuantizationStep() const
+{
+	// flat cells (a survey of one level) have no extent along some axis, any step does there
+	const FVector Size = Bounds.GetSize();
+	return FVector(
+		Size.X > 0.0f ? Size.X / MAX_uint16 : 1.0f,
+		Size.Y > 0.0f ? Size.Y / MAX_uint16 : 1.0f,
+		Size.Z > 0.0f ? Size.Z / MAX_uint16 : 1.0f
+	);
+}
+
+FVector FBIMPointBuffers::GetPoint(int32 Index) const
+{
+	if (Points.Num() > 0)
+	{
+		return Points[Index];
+	}
+
+	const FVector Step = GetQuantizationStep();
+	const uint16* Quantized = &QuantizedPoints[3 * Index];
+	return Bounds.Min + FVector(Quantized[0] * Step.X, Quantized[1] * Step.Y, Quantized[2] * Step.Z);
+}
+
+int64 GetBIMRenderSize(const TArray<FBIMMeshLOD>& LODs)
+{
+	// position, packed tangent basis and half float UV, as created below, plus baked colors
+	const int64 VertexSize = sizeof(FVector) + 2 * sizeof(FPackedNormal) + sizeof(FVector2DHalf);
+
+	int64 Size = 0;
+	for (const FBIMMeshLOD& LOD : LODs)
+	{
+		for (const FBIMMeshSection& Section : LOD.Sections)
+		{
+			const int64 IndexSize = Section.Positions.Num() > MAX_uint16 ? sizeof(uint32) : sizeof(uint16);
+			Size += Section.Positions.Num() * VertexSize + Section.Colors.Num() * sizeof(FColor) + Section.Triangles.Num() * IndexSize;
+		}
+	}
+	// the static provider keeps the renderable data it was given, in the same layout, next to the GPU buffers
+	return 2 * Size;
+}
+
+void CreateBIMSections(URuntimeMeshProviderStatic* Provider, const TArray<FBIMMeshLOD>& LODs)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMCreateSections);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_CreateSections);
+
+	TArray<FRuntimeMeshLODProperties> LODProperties;
+	for (const FBIMMeshLOD& LOD : LODs)
+	{
+		FRuntimeMeshLODProperties Properties = FRuntimeMeshLODProperties();
+		Properties.ScreenSize = LOD.ScreenSize;
+		LODProperties.Add(Properties);
+	}
+	Provider->ConfigureLODs(LODProperties);
+
+	for (int32 LODIndex = 0; LODIndex < LODs.Num(); LODIndex++)
+	{
+		const TArray<FBIMMeshSection>& Sections = LODs[LODIndex].Sections;
+		for (int32 SectionIndex = 0; SectionIndex < Sections.Num(); SectionIndex++)
+		{
+			const FBIMMeshSection& Section = Sections[SectionIndex];
+			const int32 NumVertices = Section.Positions.Num();
+			const bool bHasNormals = Section.Normals.Num() == NumVertices;
+			const bool bHasTangents = Section.Tangents.Num() == NumVertices;
+			const bool bHasTexCoords = Section.TexCoords.Num() == NumVertices;
+			const bool bHasColors = Section.Colors.Num() == NumVertices;
+
+			// packed tangents, half float UVs and 16-bit indices unless the section is too big for them
+			FRuntimeMeshSectionProperties Properties;
+			Properties.MaterialSlot = 0;
+			Properties.UpdateFrequency = ERuntimeMeshUpdateFrequency::Infrequent;
+			Properties.bUseHighPrecisionTangents = false;
+			Properties.bUseHighPrecisionTexCoords = false;
+			Properties.NumTexCoords = 1;
+			Properties.bWants32BitIndices = NumVertices > MAX_uint16;
+
+			// the vertex factory needs every stream, missing ones are only filled in here
+			FRuntimeMeshRenderableMeshData Data(false, false, 1, Properties.bWants32BitIndices);
+			for (int32 v = 0; v < NumVertices; v++)
+			{
+				const FVector TangentZ = bHasNormals ? Section.Normals[v].ToFVector() : FVector::UpVector;
+				const FVector4 TangentX = bHasTangents ? Section.Tangents[v].ToFVector4() : FVector4(FVector::ForwardVector, 1.0f);
+				const FVector TangentY = (TangentZ ^ FVector(TangentX)) * TangentX.W;
+
+				Data.Positions.Add(Section.Positions[v]);
+				Data.Tangents.Add(FVector(TangentX), TangentY, TangentZ);
+				Data.TexCoords.Add(bHasTexCoords ? FVector2D(Section.TexCoords[v]) : FVector2D::ZeroVector);
+				if (bHasColors)
+				{
+					Data.Colors.Add(Section.Colors[v]);
+				}
+			}
+			for (const int32 Index : Section.Triangles)
+			{
+				Data.Triangles.Add(Index);
+			}
+
+			Provider->CreateSection(LODIndex, SectionIndex, Properties, Data);
+		}
+	}
+}
+
+void EnableBIMCollision(URuntimeMeshProviderStatic* Provider, int32 LODIndex, int32 NumSections)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_EnableCollision);
+
+	// cooked on a background thread, the component keeps its previous collision until it is done
+	FRuntimeMeshCollisionSettings CollisionSettings;
+	CollisionSettings.bUseComplexAsSimple = true;
+	CollisionSettings.bUseAsyncCooking = true;
+	CollisionSettings.CookingMode = ERuntimeMeshCollisionCookingMode::CollisionPerformance;
+	Provider->SetCollisionSettings(CollisionSettings);
+	Provider->SetRenderableLODForCollision(LODIndex);
+
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		Provider->SetRenderableSectionAffectsCollision(SectionIndex, true, SectionIndex == NumSections - 1);
+	}
+}
+
+void BakeBIMColor(FBIMRenderBuffers& Buffers, FColor Color)
+{
+	for (FBIMMeshLOD& LOD : Buffers.LODs)
+	{
+		for (FBIMMeshSection& Section : LOD.Sections)
+		{
+			if (Section.Colors.Num() != Section.Positions.Num())
+			{
+				Section.Colors.Init(Color, Section.Positions.Num());
+			}
+		}
+	}
+}
+
+void FBIMElementVertices::Init(const FBIMRenderBuffers& Buffers)
+{
+	Sections.Reset();
+	LODRanges.Reset();
+	if (Buffers.LODs.Num() == 0 || Buffers.LODs[0].Sections.Num() == 0 || Buffers.LODs[0].Sections[0].Colors.Num() == 0)
+	{
+		return;
+	}
+
+	for (const FBIMElementRange& Element : Buffers.Elements)
+	{
+		Sections.Add(Element.SectionIndex);
+	}
+	for (const FBIMMeshLOD& LOD : Buffers.LODs)
+	{
+		LODRanges.Add(LOD.ElementVertices);
+	}
+}
+
+void FBIMElementVertices::SetColor(URuntimeMeshProviderStatic* Provider, const TArray<int32>& Elements, FColor Color) const
+{
+	// sections are re-uploaded whole, once per call however many of their elements change
+	for (int32 LODIndex = 0; LODIndex < LODRanges.Num(); LODIndex++)
+	{
+		TSet<int32> Changed;
+		for (const int32 Element : Elements)
+		{
+			if (Sections.IsValidIndex(Element) && LODRanges[LODIndex].IsValidIndex(Element))
+			{
+				Changed.Add(Sections[Element]);
+			}
+		}
+
+		for (const int32 SectionIndex : Changed)
+		{
+			// the static provider keeps a copy of every section, read through the provider interface
+			FRuntimeMeshRenderableMeshData Data;
+			if (!static_cast<URuntimeMeshProvider*>(Provider)->GetSectionMeshForLOD(LODIndex, SectionIndex, Data)) continue;
+
+			for (const int32 Element : Elements)
+			{
+				if (!Sections.IsValidIndex(Element) || Sections[Element] != SectionIndex || !LODRanges[LODIndex].IsValidIndex(Element)) continue;
+
+				const FIntPoint Range = LODRanges[LODIndex][Element];
+				for (int32 v = Range.X; v < FMath::Min(Range.X + Range.Y, Data.Colors.Num()); v++)
+				{
+					Data.Colors.SetColor(v, Color);
+				}
+			}
+			Provider->UpdateSection(LODIndex, SectionIndex, Data);
+		}
+	}
+}
@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMMeshSimplifier.h"
+#include "BIMImporterStats.h"
+
+// boundary edges are held in place by planes weighted this much more than surface planes
+#define BOUNDARY_WEIGHT 10.0
+
+// stop adding LODs if a collapse pass removes less than this fraction of triangles
+#define MIN_REDUCTION 0.1f
+
+namespace
+{
+	// Symmetric 4x4 error quadric of a set of planes
+	struct FQuadric
+	{
+		double XX = 0.0, XY = 0.0, XZ = 0.0, XW = 0.0;
+		double YY = 0.0, YZ = 0.0, YW = 0.0;
+		double ZZ = 0.0, ZW = 0.0;
+		double WW = 0.0;
+
+		FQuadric()
+		{
+		}
+
+		// plane N.P + D = 0 (N normalized), scaled by Weight
+		FQuadric(const FVector& N, const double D, const double Weight)
+		{
+			XX = Weight * N.X * N.X; XY = Weight * N.X * N.Y; XZ = Weight * N.X * N.Z; XW = Weight * N.X * D;
+			YY = Weight * N.Y * N.Y; YZ = Weight * N.Y * N.Z; YW = Weight * N.Y * D;
+			ZZ = Weight * N.Z * N.Z; ZW = Weight * N.Z * D;
+			WW = Weight * D * D;
+		}
+
+		FQuadric& operator+=(const FQuadric& Other)
+		{
+			XX += Other.XX; XY += Other.XY; XZ += Other.XZ; XW += Other.XW;
+			YY += Other.YY; YZ += Other.YZ; YW += Other.YW;
+			ZZ += Other.ZZ; ZW += Other.ZW;
+			WW += Other.WW;
+			return *this;
+		}
+
+		// squared distance of P to the planes
+		double Evaluate(const FVector& P) const
+		{
+			const double X = P.X, Y = P.Y, Z = P.Z;
+			return XX * X * X + 2.0 * XY * X * Y + 2.0 * XZ * X * Z + 2.0 * XW * X
+				+ YY * Y * Y + 2.0 * YZ * Y * Z + 2.0 * YW * Y
+				+ ZZ * Z * Z + 2.0 * ZW * Z
+				+ WW;
+		}
+	};
+
+	// Collapse of vertex From onto vertex To, valid while both versions are unchanged
+	struct FCollapse
+	{
+		double Cost;
+		int32 From;
+		int32 To;
+		uint32 FromVersion;
+		uint32 ToVersion;
+	};
+
+	struct FCollapseLess
+	{
+		bool operator()(const FCollapse& A, const FCollapse& B) const
+		{
+			return A.Cost < B.Cost;
+		}
+	};
+
+	FORCEINLINE uint64 EdgeKey(int32 A, int32 B)
+	{
+		return A < B ? (uint64(A) << 32) | uint32(B) : (uint64(B) << 32) | uint32(A);
+	}
+}
+
+bool FBIMMeshSimplifier::Simplify(const FBIMMeshSection& Source, int32 TargetTriangleCount, FBIMMeshSection& OutSection)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_SimplifyMesh);
+
+	const TArray<FVector>& Positions = Source.Positions;
+	const int32 NumVertices = Positions.Num();
+	const int32 NumTriangles = Source.Triangles.Num() / 3;
+
+	if (NumTriangles <= TargetTriangleCount || NumTriangles < 4)
+	{
+		return false;
+	}
+
+	// Weld by position: every vertex maps to the first vertex at the same position
+	TArray<int32> Canonical;
+	Canonical.SetNumUninitialized(NumVertices);
+	{
+		TMap<FVector, int32> FirstAtPosition;
+		FirstAtPosition.Reserve(NumVertices);
+		for (int32 v = 0; v < NumVertices; v++)
+		{
+			if (const int32* Found = FirstAtPosition.Find(Positions[v]))
+			{
+				Canonical[v] = *Found;
+			}
+			else
+			{
+				FirstAtPosition.Add(Positions[v], v);
+				Canonical[v] = v;
+			}
+		}
+	}
+
+	// Working corners in welded vertex ids
+	TArray<int32> Corners;
+	Corners.SetNumUninitialized(NumTriangles * 3);
+	for (int32 c = 0; c < NumTriangles * 3; c++)
+	{
+		Corners[c] = Canonical[Source.Triangles[c]];
+	}
+
+	TArray<bool> FaceRemoved;
+	FaceRemoved.SetNumZeroed(NumTriangles);
+	TArray<TArray<int32>> VertexFaces;
+	VertexFaces.SetNum(NumVertices);
+	TArray<FQuadric> Quadrics;
+	Quadrics.SetNum(NumVertices);
+	TMap<uint64, int32> EdgeFaceCount;
+	EdgeFaceCount.Reserve(NumTriangles * 2);
+
+	int32 LiveTriangles = 0;
+	for (int32 f = 0; f < NumTriangles; f++)
+	{
+		const int32 A = Corners[3 * f], B = Corners[3 * f + 1], C = Corners[3 * f + 2];
+		if (A == B || A == C || B == C)
+		{
+			FaceRemoved[f] = true;
+			continue;
+		}
+		LiveTriangles++;
+
+		const FVector Cross = (Positions[B] - Positions[A]) ^ (Positions[C] - Positions[A]);
+		const float DoubleArea = Cross.Size();
+		if (DoubleArea > SMALL_NUMBER)
+		{
+			const FVector N = Cross / DoubleArea;
+			const FQuadric Q(N, -(N | Positions[A]), 0.5 * DoubleArea);
+			Quadrics[A] += Q;
+			Quadrics[B] += Q;
+			Quadrics[C] += Q;
+		}
+
+		VertexFaces[A].Add(f);
+		VertexFaces[B].Add(f);
+		VertexFaces[C].Add(f);
+		EdgeFaceCount.FindOrAdd(EdgeKey(A, B))++;
+		EdgeFaceCount.FindOrAdd(EdgeKey(B, C))++;
+		EdgeFaceCount.FindOrAdd(EdgeKey(C, A))++;
+	}
+
+	// Keep open borders in place with planes perpendicular to the face through the edge
+	for (int32 f = 0; f < NumTriangles; f++)
+	{
+		if (FaceRemoved[f]) continue;
+
+		const FVector FaceNormal = ((Positions[Corners[3 * f + 1]] - Positions[Corners[3 * f]]) ^ (Positions[Corners[3 * f + 2]] - Positions[Corners[3 * f]])).GetSafeNormal();
+		for (int32 k = 0; k < 3; k++)
+		{
+			const int32 A = Corners[3 * f + k];
+			const int32 B = Corners[3 * f + (k + 1) % 3];
+			if (EdgeFaceCount.FindRef(EdgeKey(A, B)) != 1) continue;
+
+			const FVector Edge = Positions[B] - Positions[A];
+			const FVector N = (Edge ^ FaceNormal).GetSafeNormal();
+			const FQuadric Q(N, -(N | Positions[A]), BOUNDARY_WEIGHT * Edge.SizeSquared());
+			Quadrics[A] += Q;
+			Quadrics[B] += Q;
+		}
+	}
+
+	TArray<uint32> Versions;
+	Versions.SetNumZeroed(NumVertices);
+	TArray<FCollapse> Heap;
+	Heap.Reserve(EdgeFaceCount.Num());
+
+	// Half-edge collapse: the cheaper of the two endpoints survives in place
+	auto PushEdge = [&](const int32 A, const int32 B)
+	{
+		FQuadric Q = Quadrics[A];
+		Q += Quadrics[B];
+		const double CostAToB = Q.Evaluate(Positions[B]);
+		const double CostBToA = Q.Evaluate(Positions[A]);
+		if (CostAToB <= CostBToA)
+		{
+			Heap.HeapPush(FCollapse{ CostAToB, A, B, Versions[A], Versions[B] }, FCollapseLess());
+		}
+		else
+		{
+			Heap.HeapPush(FCollapse{ CostBToA, B, A, Versions[B], Versions[A] }, FCollapseLess());
+		}
+	};
+
+	for (const TPair<uint64, int32>& Edge : EdgeFaceCount)
+	{
+		PushEdge(int32(Edge.Key >> 32), int32(Edge.Key & 0xffffffff));
+	}
+	EdgeFaceCount.Empty();
+
+	TArray<int32> Neighbours;
+	while (LiveTriangles > TargetTriangleCount && Heap.Num() > 0)
+	{
+		FCollapse Collapse;
+		Heap.HeapPop(Collapse, FCollapseLess(), false);
+
+		const int32 From = Collapse.From;
+		const int32 To = Collapse.To;
+
+		// stale: one of the vertices changed since this edge was evaluated
+		if (Versions[From] != Collapse.FromVersion || Versions[To] != Collapse.ToVersion) continue;
+
+		// reject collapses that flip a face moving with From
+		bool bFlips = false;
+		for (const int32 f : VertexFaces[From])
+		{
+			if (FaceRemoved[f]) continue;
+
+			const int32* Tri = &Corners[3 * f];
+			if (Tri[0] == To || Tri[1] == To || Tri[2] == To) continue;
+
+			const FVector P0 = Positions[Tri[0]], P1 = Positions[Tri[1]], P2 = Positions[Tri[2]];
+			const FVector Before = (P1 - P0) ^ (P2 - P0);
+			const FVector Q0 = Tri[0] == From ? Positions[To] : P0;
+			const FVector Q1 = Tri[1] == From ? Positions[To] : P1;
+			const FVector Q2 = Tri[2] == From ? Positions[To] : P2;
+			const FVector After = (Q1 - Q0) ^ (Q2 - Q0);
+			if ((Before | After) <= 0.0f)
+			{
+				bFlips = true;
+				break;
+			}
+		}
+		if (bFlips) continue;
+
+		// collapse From onto To
+		for (const int32 f : VertexFaces[From])
+		{
+			if (FaceRemoved[f]) continue;
+
+			int32* Tri = &Corners[3 * f];
+			if (Tri[0] == To || Tri[1] == To || Tri[2] == To)
+			{
+				FaceRemoved[f] = true;
+				LiveTriangles--;
+				continue;
+			}
+
+			for (int32 k = 0; k < 3; k++)
+			{
+				if (Tri[k] == From) Tri[k] = To;
+			}
+			VertexFaces[To].Add(f);
+		}
+		VertexFaces[From].Empty();
+		Quadrics[To] += Quadrics[From];
+		Versions[From]++;
+		Versions[To]++;
+
+		// re-evaluate the edges around the surviving vertex
+		Neighbours.Reset();
+		for (const int32 f : VertexFaces[To])
+		{
+			if (FaceRemoved[f]) continue;
+			for (int32 k = 0; k < 3; k++)
+			{
+				if (Corners[3 * f + k] != To) Neighbours.AddUnique(Corners[3 * f + k]);
+			}
+		}
+		for (const int32 Neighbour : Neighbours)
+		{
+			PushEdge(To, Neighbour);
+		}
+	}
+
+	const int32 NumTrianglesLeft = LiveTriangles;
+	if (NumTrianglesLeft == 0 || NumTrianglesLeft > NumTriangles * (1.0f - MIN_REDUCTION))
+	{
+		return false;
+	}
+
+	// Corners that were never moved keep their original vertex (and its normal/UV), moved ones use the survivor
+	TArray<int32> Triangles;
+	Triangles.Reserve(NumTrianglesLeft * 3);
+	for (int32 f = 0; f < NumTriangles; f++)
+	{
+		if (FaceRemoved[f]) continue;
+		for (int32 k = 0; k < 3; k++)
+		{
+			const int32 Original = Source.Triangles[3 * f + k];
+			Triangles.Add(Canonical[Original] == Corners[3 * f + k] ? Original : Corners[3 * f + k]);
+		}
+	}
+
+	CompactSection(Source, Triangles, OutSection);
+	return true;
+}
+
+void FBIMMeshSimplifier::CompactSection(const FBIMMeshSection& Source, const TArray<int32>& Triangles, FBIMMeshSection& OutSection)
+{
+	const bool bHasNormals = Source.Normals.Num() == Source.Positions.Num();
+	const bool bHasTangents = Source.Tangents.Num() == Source.Positions.Num();
+	const bool bHasTexCoords = Source.TexCoords.Num() == Source.Positions.Num();
+	const bool bHasColors = Source.Colors.Num() == Source.Positions.Num();
+
+	TArray<int32> Remap;
+	Remap.Init(INDEX_NONE, Source.Positions.Num());
+	OutSection.Triangles.SetNumUninitialized(Triangles.Num());
+
+	for (int32 c = 0; c < Triangles.Num(); c++)
+	{
+		const int32 Old = Triangles[c];
+		if (Remap[Old] == INDEX_NONE)
+		{
+			Remap[Old] = OutSection.Positions.Add(Source.Positions[Old]);
+			if (bHasNormals) OutSection.Normals.Add(Source.Normals[Old]);
+			if (bHasTangents) OutSection.Tangents.Add(Source.Tangents[Old]);
+			if (bHasTexCoords) OutSection.TexCoords.Add(Source.TexCoords[Old]);
+			if (bHasColors) OutSection.Colors.Add(Source.Colors[Old]);
+		}
+		OutSection.Triangles[c] = Remap[Old];
+	}
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMMeshData.h"
+
+/**
+ * Quadric error metric mesh simplification (Garland & Heckbert) using half-edge collapses,
+ * so simplified LODs only reference vertices of the source section. Thread-safe, no UObjects
+ */
+class FBIMMeshSimplifier
+{
+public:
+	/**
+	 * Simplify Source down to about TargetTriangleCount triangles. Vertices sharing a position are
+	 * collapsed together, corners that survive keep their original normals and UVs.
+	 * Returns false if the mesh could not be reduced meaningfully (OutSection is left empty)
+	 */
+	static bool Simplify(const FBIMMeshSection& Source, int32 TargetTriangleCount, FBIMMeshSection& OutSection);
+
+private:
+	// Copy the vertices referenced by Triangles from Source into a new, compact section
+	static void CompactSection(const FBIMMeshSection& Source, const TArray<int32>& Triangles, FBIMMeshSection& OutSection);
+};
@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMPointCloudActor.h"
+
+#include "Providers/RuntimeMeshProviderStatic.h"
+#include "Async/ParallelFor.h"
+#include "Hash/CityHash.h"
+#include "BIMImporterStats.h"
+
+// every LOD keeps a quarter of the points of the previous one
+#define MAX_POINT_LODS 4
+
+namespace
+{
+	// Corners of the sprite triangle in point radii: the dot of radius 1 is its incircle. Wound to face up
+	const FVector2D SpriteCorners[3] = { FVector2D(2.0f, 0.0f), FVector2D(-1.0f, -1.7320508f), FVector2D(-1.0f, 1.7320508f) };
+
+	// Points of one grid cell and combination of layers, grouped by source mesh as they are collected
+	struct FPointCell
+	{
+		FBIMOrigin Origin;
+		int32 CategorySet = INDEX_NONE;
+		TArray<FVector> Points;
+
+		// (source mesh, first point) of every source mesh with points in the cell
+		TArray<FIntPoint> Sources;
+	};
+
+	// Spread the low 10 bits of V so two zero bits follow each of them
+	uint32 SpreadBits(uint32 V)
+	{
+		V &= 0x3FF;
+		V = (V | V << 16) & 0x030000FF;
+		V = (V | V << 8) & 0x0300F00F;
+		V = (V | V << 4) & 0x030C30C3;
+		V = (V | V << 2) & 0x09249249;
+		return V;
+	}
+
+	// Sort points along a Z-order curve over Bounds, so neighbours in the array are neighbours in space
+	void SortMorton(FVector* Points, int32 NumPoints, const FBox& Bounds)
+	{
+		const FVector Size = Bounds.GetSize();
+		const FVector Scale(
+			Size.X > 0.0f ? 1023.0f / Size.X : 0.0f,
+			Size.Y > 0.0f ? 1023.0f / Size.Y : 0.0f,
+			Size.Z > 0.0f ? 1023.0f / Size.Z : 0.0f
+		);
+
+		TArray<TPair<uint32, FVector>> Keyed;
+		Keyed.SetNumUninitialized(NumPoints);
+		for (int32 i = 0; i < NumPoints; i++)
+		{
+			const FVector Cell = (Points[i] - Bounds.Min) * Scale;
+			Keyed[i].Key = SpreadBits(FMath::TruncToInt(Cell.X)) | SpreadBits(FMath::TruncToInt(Cell.Y)) << 1 | SpreadBits(FMath::TruncToInt(Cell.Z)) << 2;
+			Keyed[i].Value = Points[i];
+		}
+		Keyed.Sort([](const TPair<uint32, FVector>& A, const TPair<uint32, FVector>& B) { return A.Key < B.Key; });
+
+		for (int32 i = 0; i < NumPoints; i++)
+		{
+			Points[i] = Keyed[i].Value;
+		}
+	}
+}
+
+// Sets default values
+ABIMPointCloudActor::ABIMPointCloudActor()
+{
+	StaticProvider = CreateDefaultSubobject<URuntimeMeshProviderStatic>(TEXT("Static Provider"));
+	StaticProvider->SetShouldSerializeMeshData(false);
+	PrimaryActorTick.bCanEverTick = false;
+}
+
+void ABIMPointCloudActor::BuildPointBuffers(const TArray<aiMesh*>& PointObjs, const TArray<int32>& CategorySets, const FBIMImportSettings& Settings, TArray<FBIMPointBuffers>& OutBuffers)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_BuildPointBuffers);
+
+	// cells are absolute, so points of every layer share their grid, and their centers are the buffers' origins.
+	// Layers are toggled per actor, so each combination of them gets cells of its own
+	const double CellSize = FMath::Max(Settings.ClusterCellSize, 100.0f);
+	TMap<TTuple<FIntVector, int32>, int32> CellIndices;
+	TArray<FPointCell> Cells;
+	for (int32 SourceIndex = 0; SourceIndex < PointObjs.Num(); SourceIndex++)
+	{
+		const aiMesh* AiMesh = PointObjs[SourceIndex];
+		const int32 CategorySet = FBIMCategories::GetSet(CategorySets, SourceIndex);
+		for (unsigned int f = 0; f < AiMesh->mNumFaces; f++)
+		{
+			const aiFace& Face = AiMesh->mFaces[f];
+			if (Face.mNumIndices != 1) continue;
+
+			// centimeters in Unreal axes, like FBIMOrigin::ToLocal
+			const aiVector3D& Vertex = AiMesh->mVertices[Face.mIndices[0]];
+			const FIntVector Key(
+				static_cast<int32>(FMath::FloorToDouble(Vertex.y * 100.0 / CellSize)),
+				static_cast<int32>(FMath::FloorToDouble(Vertex.x * 100.0 / CellSize)),
+				static_cast<int32>(FMath::FloorToDouble(Vertex.z * 100.0 / CellSize))
+			);
+
+			const int32* Found = CellIndices.Find(MakeTuple(Key, CategorySet));
+			const int32 CellIndex = Found ? *Found : CellIndices.Add(MakeTuple(Key, CategorySet), Cells.AddDefaulted());
+			FPointCell& Cell = Cells[CellIndex];
+			if (!Found)
+			{
+				Cell.Origin = FBIMOrigin((Key.X + 0.5) * CellSize, (Key.Y + 0.5) * CellSize, (Key.Z + 0.5) * CellSize);
+				Cell.CategorySet = CategorySet;
+			}
+
+			if (Cell.Sources.Num() == 0 || Cell.Sources.Last().X != SourceIndex)
+			{
+				Cell.Sources.Emplace(SourceIndex, Cell.Points.Num());
+			}
+			Cell.Points.Add(Cell.Origin.ToLocal(Vertex.x, Vertex.y, Vertex.z));
+		}
+	}
+
+	OutBuffers.SetNum(Cells.Num());
+	ParallelFor(Cells.Num(), [&](int32 CellIndex)
+	{
+		FPointCell& Cell = Cells[CellIndex];
+		FBIMPointBuffers& Buffers = OutBuffers[CellIndex];
+		Buffers.Origin = Cell.Origin;
+		Buffers.MaterialIndex = PointObjs[Cell.Sources[0].X]->mMaterialIndex;
+		Buffers.Bounds = FBox(Cell.Points);
+
+		// each source mesh keeps its own range, in Morton order within it
+		for (int32 i = 0; i < Cell.Sources.Num(); i++)
+		{
+			const int32 First = Cell.Sources[i].Y;
+			const int32 Num = (i + 1 < Cell.Sources.Num() ? Cell.Sources[i + 1].Y : Cell.Points.Num()) - First;
+			SortMorton(&Cell.Points[First], Num, Buffers.Bounds);
+
+			FBIMElementRange& Element = Buffers.Elements.AddDefaulted_GetRef();
+			Element.SourceIndex = Cell.Sources[i].X;
+			Element.CategorySet = Cell.CategorySet;
+			Element.FirstIndex = First;
+			Element.NumIndices = Num;
+			Element.Bounds = FBox(&Cell.Points[First], Num);
+
+			// points are local to the cell, so its origin is part of their geometry
+			const uint64 CellHash = CityHash64(reinterpret_cast<const char*>(&Cell.Origin), sizeof(FBIMOrigin));
+			Element.GeometryHash = CityHash64WithSeed(reinterpret_cast<const char*>(&Cell.Points[First]), Num * sizeof(FVector), CellHash);
+		}
+
+		if (!Settings.bQuantizePoints)
+		{
+			Buffers.Points = MoveTemp(Cell.Points);
+			return;
+		}
+
+		const FVector Step = Buffers.GetQuantizationStep();
+		Buffers.QuantizedPoints.SetNumUninitialized(3 * Cell.Points.Num());
+		for (int32 i = 0; i < Cell.Points.Num(); i++)
+		{
+			const FVector Quantized = (Cell.Points[i] - Buffers.Bounds.Min) / Step;
+			Buffers.QuantizedPoints[3 * i + 0] = FMath::Clamp(FMath::RoundToInt(Quantized.X), 0, (int32)MAX_uint16);
+			Buffers.QuantizedPoints[3 * i + 1] = FMath::Clamp(FMath::RoundToInt(Quantized.Y), 0, (int32)MAX_uint16);
+			Buffers.QuantizedPoints[3 * i + 2] = FMath::Clamp(FMath::RoundToInt(Quantized.Z), 0, (int32)MAX_uint16);
+		}
+	});
+}
+
+void ABIMPointCloudActor::CreateMeshFromBuffers(const FBIMPointBuffers& Buffers, const FBIMImportSettings& Settings)
+{
+	const int32 NumPoints = Buffers.NumPoints();
+	if (RenderMemory > 0 || NumPoints == 0) return;
+
+	// Clear RMC
+	GetRuntimeMeshComponent()->Initialize(StaticProvider);
+	StaticProvider->ClearSection(0, 0);
+
+	// sprites only exist for the upload, the buffers hold positions only
+	TArray<FBIMMeshLOD> LODs;
+	const int32 NumLODs = FMath::Clamp(Settings.PointLODScreenSizes.Num(), 1, MAX_POINT_LODS);
+	for (int32 LODIndex = 0; LODIndex < NumLODs; LODIndex++)
+	{
+		// every 4th point of the previous LOD, twice as large so the cell stays as covered. Stops once a single point is left
+		const int32 Stride = 1 << (2 * LODIndex);
+		if (LODIndex > 0 && Stride / 4 >= NumPoints) break;
+
+		FBIMMeshLOD& LOD = LODs.AddDefaulted_GetRef();
+		LOD.ScreenSize = Settings.PointLODScreenSizes.IsValidIndex(LODIndex) ? Settings.PointLODScreenSizes[LODIndex] : 1.0f;
+		FBIMMeshSection& Section = LOD.Sections.AddDefaulted_GetRef();
+
+		const int32 NumLODPoints = FMath::DivideAndRoundUp(NumPoints, Stride);
+		Section.Positions.Reserve(3 * NumLODPoints);
+		Section.TexCoords.Reserve(3 * NumLODPoints);
+		Section.Triangles.Reserve(3 * NumLODPoints);
+
+		const float Radius = 0.5f * Settings.PointSize * (1 << LODIndex);
+		for (int32 i = 0; i < NumPoints; i += Stride)
+		{
+			const FVector Point = Buffers.GetPoint(i);
+			for (const FVector2D& Corner : SpriteCorners)
+			{
+				Section.Triangles.Add(Section.Positions.Num());
+				Section.Positions.Add(Point + FVector(Corner * Radius, 0.0f));
+				Section.TexCoords.Add(FVector2DHalf(Corner));
+			}
+		}
+	}
+
+	// Create RMC sections of every LOD
+	CreateBIMSections(StaticProvider, LODs);
+	StaticProvider->SetupMaterialSlot(0, TEXT("BIM Material"), Material);
+	RenderMemory = GetBIMRenderSize(LODs);
+	INC_MEMORY_STAT_BY(STAT_BIMRenderMemory, RenderMemory);
+
+	// points never collide. Screen size is about bounds radius over distance at a 90 degree field of view
+	URuntimeMeshComponent* Component = GetRuntimeMeshComponent();
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	if (Settings.PointCullScreenSize > 0.0f)
+	{
+		Component->SetCullDistance(Buffers.Bounds.GetExtent().Size() / Settings.PointCullScreenSize);
+	}
+
+	Origin = Buffers.Origin;
+}
+
+void ABIMPointCloudActor::BeginDestroy()
+{
+	DEC_MEMORY_STAT_BY(STAT_BIMRenderMemory, RenderMemory);
+	RenderMemory = 0;
+
+	Super::BeginDestroy();
+}
+
+void ABIMPointCloudActor::PlaceAtReference(const FBIMOrigin& Reference)
+{
+	const FVector Location = Origin - Reference;
+	if (GetActorLocation().Equals(Location)) return;
+
+	// runtime mesh actors are static by default, re-anchoring needs to move them
+	GetRootComponent()->SetMobility(EComponentMobility::Movable);
+	SetActorLocation(Location);
+}
+
+void ABIMPointCloudActor::SetRefs(float Easting, float Northing, float Altitude)
+{
+	RefEasting = Easting;
+	RefNorthing = Northing;
+	RefAltitude = Altitude;
+}
+
+void ABIMPointCloudActor::SetMaterial(UMaterialInstance* MaterialInstance)
+{
+	// change material
+	Material = MaterialInstance;
+
+	if (GetRuntimeMeshComponent()->GetProvider())
+	{
+		StaticProvider->SetupMaterialSlot(0, TEXT("BIM Material"), Material);
+	}
+}
@@ -4,10 +4,25 @@
 #include "BIMPolyLineActor.h"
 
 #include "Providers/RuntimeMeshProviderStatic.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/CollisionProfile.h"
+#include "BIMImporterStats.h"
 
-#define SECTOR_COUNT 10
 #define RADIUS 50.0f
 
+// Tube LODs: full tube, 6-sided tube and open 3-sided prism. Far LODs are thicker so lines stay visible
+#define LOD0_SECTOR_COUNT 10
+#define LOD1_SECTOR_COUNT 6
+#define LOD2_SECTOR_COUNT 3
+#define MAX_LINE_LODS 3
+
+// simplified collision: an open tube at the true radius, fewer sides than the full one
+#define COLLISION_SECTOR_COUNT 5
+
+// mitered joints widen the tube by 1 / cos(half the bend), at most 1.41 since sharper turns cut the chain
+#define MAX_MITER_SCALE 1.5f
+
 // Sets default values
 ABIMPolyLineActor::ABIMPolyLineActor()
 {
@@ -18,133 +33,594 @@ ABIMPolyLineActor::ABIMPolyLineActor()
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-// returns points on unit circle
-// TODO: precalculate trig functions and test performance
-FVector GetSectorPoint(int Index)
+// Taylor series sine/cosine, usable in constant expressions. X must be in [-PI, PI]
+constexpr double ConstSin(const double X)
 {
-	const float Phi = Index * (2.0f * PI) / static_cast<float>(SECTOR_COUNT);
-	return FVector(0.0f, -FMath::Cos(Phi), FMath::Sin(Phi));
+	double Term = X;
+	double Sum = X;
+	for (int n = 1; n < 12; n++)
+	{
+		Term *= -X * X / ((2.0 * n) * (2.0 * n + 1.0));
+		Sum += Term;
+	}
+	return Sum;
 }
 
-// Store cylinder positions, coords, etc. to supplied arrays
-void CreateCylinder(FVector &Top, FVector &Bot, TArray<FVector> &PositionsLOD0, TArray<FVector> &PositionsLOD1, TArray<FVector> &PositionsLOD2, TArray<FVector> &Normals, TArray<int32> &Triangles)
+constexpr double ConstCos(const double X)
 {
-	// First index
-	int FirstIndex = PositionsLOD0.Num();
-	
-	// calculate and set direction of vertices
+	double Term = 1.0;
+	double Sum = 1.0;
+	for (int n = 1; n < 12; n++)
+	{
+		Term *= -X * X / ((2.0 * n - 1.0) * (2.0 * n));
+		Sum += Term;
+	}
+	return Sum;
+}
+
+// Unit circle points of one tube ring (scaled by RADIUS), computed at compile time
+template <int SectorCount>
+struct TTubeTable
+{
+	// sector point i is (0, RingY[i], RingZ[i]) in the ring frame
+	float RingY[SectorCount];
+	float RingZ[SectorCount];
+
+	constexpr TTubeTable() : RingY(), RingZ()
+	{
+		for (int i = 0; i < SectorCount; i++)
+		{
+			double Phi = i * (2.0 * PI) / SectorCount;
+			Phi = Phi > PI ? Phi - 2.0 * PI : Phi;
+			RingY[i] = static_cast<float>(-RADIUS * ConstCos(Phi));
+			RingZ[i] = static_cast<float>(RADIUS * ConstSin(Phi));
+		}
+	}
+};
+
+// Centimeter scaled end points and ring axes of one segment, shared by every LOD
+struct FTubeSegment
+{
+	FVector Bot;
+	FVector Top;
+	FVector Right;
+	FVector Up;
+};
+
+FTubeSegment MakeTubeSegment(const FVector& Top, const FVector& Bot)
+{
+	// Frame of the segment. Same axes as Direction.Rotation().Quaternion() (zero roll), without the trig
 	FVector Direction = Top - Bot;
-	Direction.Normalize();
-	const FQuat Q = Direction.Rotation().Quaternion();
+	if (!Direction.Normalize())
+	{
+		Direction = FVector::ForwardVector;
+	}
+	const float CosPitch = FMath::Sqrt(Direction.X * Direction.X + Direction.Y * Direction.Y);
+	float CosYaw = 1.0f;
+	float SinYaw = 0.0f;
+	if (CosPitch > SMALL_NUMBER)
+	{
+		CosYaw = Direction.X / CosPitch;
+		SinYaw = Direction.Y / CosPitch;
+	}
+
+	FTubeSegment Segment;
+	Segment.Bot = Bot;
+	Segment.Top = Top;
+	Segment.Right = FVector(-SinYaw, CosYaw, 0.0f);
+	Segment.Up = FVector(-Direction.Z * CosYaw, -Direction.Z * SinYaw, CosPitch);
+	return Segment;
+}
+
+// One ring of a tube: its center and axes, shared by every LOD
+struct FTubeRing
+{
+	FVector Center;
+	FVector Right;
+	FVector Up;
+
+	// at joints, offsets along Miter are stretched by MiterScale so the tube keeps its width through the bend
+	FVector Miter = FVector::ZeroVector;
+	float MiterScale = 1.0f;
+};
+
+// Connected segments as runs of rings: one ring per point of a polyline instead of two per segment
+struct FTubeChains
+{
+	TArray<FTubeRing> Rings;
+
+	// first ring of every chain
+	TArray<int32> ChainStarts;
+};
+
+// Rings of one polyline. Frames are carried from ring to ring (parallel transport), so the tube doesn't twist
+void AddTubeChain(const TArray<FVector>& Points, FTubeChains& OutChains)
+{
+	OutChains.ChainStarts.Add(OutChains.Rings.Num());
+
+	// the first ring has the frame of a lone segment, so single segments come out as they always did
+	const FTubeSegment First = MakeTubeSegment(Points[1], Points[0]);
+	FVector Right = First.Right;
+	FVector Up = First.Up;
+	FVector PrevDirection = (Points[1] - Points[0]).GetSafeNormal();
 
-	for (int i = 0; i < SECTOR_COUNT; i++)
+	for (int32 i = 0; i < Points.Num(); i++)
 	{
-		FVector BotPoint0 = RADIUS * GetSectorPoint(i);
-		FVector BotPoint1 = RADIUS * 2.0 * GetSectorPoint(i);
-		FVector BotPoint2 = RADIUS * 3.0 * GetSectorPoint(i);
-		BotPoint0 = Q * BotPoint0 + Bot;
-		BotPoint1 = Q * BotPoint1 + Bot;
-		BotPoint2 = Q * BotPoint2 + Bot;
-		PositionsLOD0.Push(BotPoint0);
-		PositionsLOD1.Push(BotPoint1);
-		PositionsLOD2.Push(BotPoint2);
+		FTubeRing& Ring = OutChains.Rings.AddDefaulted_GetRef();
+		Ring.Center = Points[i];
+
+		// joints are mitered: the ring lies in the plane halving the bend
+		FVector Tangent = PrevDirection;
+		if (i > 0 && i + 1 < Points.Num())
+		{
+			const FVector NextDirection = (Points[i + 1] - Points[i]).GetSafeNormal();
+			Tangent = (PrevDirection + NextDirection).GetSafeNormal();
+			const FVector Bend = NextDirection - PrevDirection;
+			if (!Tangent.IsZero() && Bend.SizeSquared() > KINDA_SMALL_NUMBER)
+			{
+				Ring.Miter = Bend.GetUnsafeNormal();
+				Ring.MiterScale = FMath::Min(1.0f / (Tangent | PrevDirection), MAX_MITER_SCALE);
+			}
+			PrevDirection = NextDirection;
+		}
+
+		if (i > 0 && !Tangent.IsZero())
+		{
+			const FVector Projected = Right - (Right | Tangent) * Tangent;
+			if (!Projected.IsNearlyZero())
+			{
+				Right = Projected.GetUnsafeNormal();
+				Up = Tangent ^ Right;
+			}
+		}
+		Ring.Right = Right;
+		Ring.Up = Up;
 	}
-	
-	for (int i = 0; i < SECTOR_COUNT; i++)
-	{
-		FVector TopPoint0 = RADIUS * GetSectorPoint(i);
-		FVector TopPoint1 = RADIUS * 2.0 * GetSectorPoint(i);
-		FVector TopPoint2 = RADIUS * 3.0 * GetSectorPoint(i);
-		TopPoint0 = Q * TopPoint0 + Top;
-		TopPoint1 = Q * TopPoint1 + Top;
-		TopPoint2 = Q * TopPoint2 + Top;
-		PositionsLOD0.Push(TopPoint0);
-		PositionsLOD1.Push(TopPoint1);
-		PositionsLOD2.Push(TopPoint2);
-	}
-
-	PositionsLOD0.Push(Bot);
-	PositionsLOD0.Push(Top);
-	PositionsLOD1.Push(Bot);
-	PositionsLOD1.Push(Top);
-	PositionsLOD2.Push(Bot);
-	PositionsLOD2.Push(Top);
-	
-	// Set triangles
-	for (int i = 0; i < SECTOR_COUNT; i++)
+}
+
+/*
+ * Chain the segments into polylines through the end points they share. Chains run between free ends and junctions
+ * (points shared by more than two segments), and are cut where they turn by more than 90 degrees, which a miter
+ * can't follow. Closed loops are opened at an arbitrary point
+ */
+void BuildTubeChains(const TArray<FTubeSegment>& Segments, FTubeChains& OutChains)
+{
+	// polylines repeat their shared vertices bit for bit, so end points are matched exactly
+	TMap<FVector, int32> NodeIds;
+	TArray<FVector> Nodes;
+	TArray<FIntPoint> SegmentNodes;
+	SegmentNodes.SetNumUninitialized(Segments.Num());
+	auto GetNode = [&NodeIds, &Nodes](const FVector& Point)
+	{
+		if (const int32* Found = NodeIds.Find(Point))
+		{
+			return *Found;
+		}
+		NodeIds.Add(Point, Nodes.Num());
+		return Nodes.Add(Point);
+	};
+	for (int32 s = 0; s < Segments.Num(); s++)
 	{
-		// indices of created vertices
-		int BotCur = FirstIndex + i;
-		int BotNext = FirstIndex + (i + 1) % SECTOR_COUNT;
-		int TopCur = BotCur + SECTOR_COUNT;
-		int TopNext = BotNext + SECTOR_COUNT;
-		int BotCenter = PositionsLOD0.Num() - 2;
-		int TopCenter = PositionsLOD0.Num() - 1;
+		SegmentNodes[s] = FIntPoint(GetNode(Segments[s].Bot), GetNode(Segments[s].Top));
+	}
+
+	// segments of every node, in compressed rows. Zero length segments join nothing
+	TArray<int32> FirstEdge;
+	FirstEdge.SetNumZeroed(Nodes.Num() + 1);
+	for (const FIntPoint& Ends : SegmentNodes)
+	{
+		if (Ends.X == Ends.Y) continue;
+		FirstEdge[Ends.X + 1]++;
+		FirstEdge[Ends.Y + 1]++;
+	}
+	for (int32 n = 0; n < Nodes.Num(); n++)
+	{
+		FirstEdge[n + 1] += FirstEdge[n];
+	}
+	TArray<int32> Edges;
+	Edges.SetNumUninitialized(FirstEdge[Nodes.Num()]);
+	TArray<int32> Filled(FirstEdge);
+	for (int32 s = 0; s < SegmentNodes.Num(); s++)
+	{
+		if (SegmentNodes[s].X == SegmentNodes[s].Y) continue;
+		Edges[Filled[SegmentNodes[s].X]++] = s;
+		Edges[Filled[SegmentNodes[s].Y]++] = s;
+	}
+	auto Degree = [&FirstEdge](int32 Node)
+	{
+		return FirstEdge[Node + 1] - FirstEdge[Node];
+	};
+
+	TBitArray<> Used(false, Segments.Num());
+	TArray<FVector> Points;
+	auto Walk = [&](int32 Node, int32 Segment)
+	{
+		Points.Reset();
+		Points.Add(Nodes[Node]);
+		while (Segment != INDEX_NONE)
+		{
+			Used[Segment] = true;
+			Node = SegmentNodes[Segment].X == Node ? SegmentNodes[Segment].Y : SegmentNodes[Segment].X;
 
-		// Side triangles
-		Triangles.Append({ BotCur, BotNext, TopNext });
-		Triangles.Append({ BotCur, TopNext, TopCur });
+			const int32 Last = Points.Num() - 1;
+			if (Last > 0 && ((Points[Last] - Points[Last - 1]) | (Nodes[Node] - Points[Last])) < 0.0f)
+			{
+				AddTubeChain(Points, OutChains);
+				Points.RemoveAt(0, Last, false);
+			}
+			Points.Add(Nodes[Node]);
 
-		// Cap triangles
-		Triangles.Append({ BotNext, BotCur, BotCenter });
-		Triangles.Append({ TopCur, TopNext, TopCenter });
+			// through joints, along the joint's other segment
+			Segment = INDEX_NONE;
+			if (Degree(Node) == 2)
+			{
+				for (int32 e = FirstEdge[Node]; e < FirstEdge[Node + 1]; e++)
+				{
+					if (!Used[Edges[e]]) Segment = Edges[e];
+				}
+			}
+		}
+		AddTubeChain(Points, OutChains);
+	};
+
+	for (int32 n = 0; n < Nodes.Num(); n++)
+	{
+		if (Degree(n) == 2) continue;
+		for (int32 e = FirstEdge[n]; e < FirstEdge[n + 1]; e++)
+		{
+			if (!Used[Edges[e]]) Walk(n, Edges[e]);
+		}
+	}
+
+	// what is left are closed loops and zero length segments
+	for (int32 s = 0; s < Segments.Num(); s++)
+	{
+		if (Used[s]) continue;
+		if (SegmentNodes[s].X != SegmentNodes[s].Y)
+		{
+			Walk(SegmentNodes[s].X, s);
+			continue;
+		}
+
+		Used[s] = true;
+		Points.Reset();
+		Points.Add(Segments[s].Bot);
+		Points.Add(Segments[s].Top);
+		AddTubeChain(Points, OutChains);
+	}
+}
+
+// Tube geometry of every chain for one LOD: side quads between consecutive rings, caps at both ends of a chain
+template <int SectorCount, bool bCaps>
+void BuildTubeLOD(const FTubeChains& Chains, const float RadiusScale, FBIMMeshSection& OutSection)
+{
+	static constexpr TTubeTable<SectorCount> Table;
+
+	const int32 NumChains = Chains.ChainStarts.Num();
+	const int32 NumRings = Chains.Rings.Num();
+	OutSection.Positions.SetNumUninitialized(NumRings * SectorCount + (bCaps ? 2 * NumChains : 0));
+	OutSection.Triangles.SetNumUninitialized((NumRings - NumChains) * 6 * SectorCount + (bCaps ? NumChains * 6 * SectorCount : 0));
+	FVector* RESTRICT Positions = OutSection.Positions.GetData();
+	int32* RESTRICT Triangles = OutSection.Triangles.GetData();
+
+	int32 Vertex = 0;
+	for (int32 c = 0; c < NumChains; c++)
+	{
+		const int32 FirstRing = Chains.ChainStarts[c];
+		const int32 EndRing = c + 1 < NumChains ? Chains.ChainStarts[c + 1] : NumRings;
+		const int32 FirstVertex = Vertex;
+
+		for (int32 r = FirstRing; r < EndRing; r++)
+		{
+			const FTubeRing& Ring = Chains.Rings[r];
+			const FVector Right = Ring.Right * RadiusScale;
+			const FVector Up = Ring.Up * RadiusScale;
+			const VectorRegister RightReg = VectorLoadFloat3_W0(&Right);
+			const VectorRegister UpReg = VectorLoadFloat3_W0(&Up);
+			const VectorRegister CenterReg = VectorLoadFloat3_W0(&Ring.Center);
+			const VectorRegister MiterReg = VectorLoadFloat3_W0(&Ring.Miter);
+			const VectorRegister StretchReg = VectorSetFloat1(Ring.MiterScale - 1.0f);
+
+			for (int i = 0; i < SectorCount; i++)
+			{
+				VectorRegister Offset = VectorMultiplyAdd(
+					VectorSetFloat1(Table.RingY[i]), RightReg,
+					VectorMultiply(VectorSetFloat1(Table.RingZ[i]), UpReg));
+				Offset = VectorMultiplyAdd(VectorMultiply(VectorDot3(Offset, MiterReg), StretchReg), MiterReg, Offset);
+				VectorStoreFloat3(VectorAdd(CenterReg, Offset), &Positions[Vertex + i]);
+			}
+
+			// side triangles to the previous ring
+			if (r > FirstRing)
+			{
+				const int32 Bot = Vertex - SectorCount;
+				const int32 Top = Vertex;
+				for (int i = 0; i < SectorCount; i++)
+				{
+					const int32 Next = (i + 1) % SectorCount;
+					*Triangles++ = Bot + i;  *Triangles++ = Bot + Next; *Triangles++ = Top + Next;
+					*Triangles++ = Bot + i;  *Triangles++ = Top + Next; *Triangles++ = Top + i;
+				}
+			}
+			Vertex += SectorCount;
+		}
+
+		// cap triangles around the end centers
+		if (bCaps)
+		{
+			const int32 Bot = FirstVertex;
+			const int32 Top = Vertex - SectorCount;
+			const int32 BotCenter = Vertex++;
+			const int32 TopCenter = Vertex++;
+			Positions[BotCenter] = Chains.Rings[FirstRing].Center;
+			Positions[TopCenter] = Chains.Rings[EndRing - 1].Center;
+			for (int i = 0; i < SectorCount; i++)
+			{
+				const int32 Next = (i + 1) % SectorCount;
+				*Triangles++ = Bot + Next; *Triangles++ = Bot + i;    *Triangles++ = BotCenter;
+				*Triangles++ = Top + i;    *Triangles++ = Top + Next; *Triangles++ = TopCenter;
+			}
+		}
+	}
+}
+
+/*
+ * One transform per segment, mapping the unit cylinder (Z-aligned, 100 units tall and wide, centered)
+ * onto the segment with the tube radius
+ */
+void BuildInstanceTransforms(const TArray<FTubeSegment>& Segments, TArray<FTransform>& OutTransforms)
+{
+	OutTransforms.SetNumUninitialized(Segments.Num());
+
+	for (int32 s = 0; s < Segments.Num(); s++)
+	{
+		const FVector& Top = Segments[s].Top;
+		const FVector& Bot = Segments[s].Bot;
+
+		FVector Direction = Top - Bot;
+		float Length = 0.0f;
+		Direction.ToDirectionAndLength(Direction, Length);
+		if (Length < SMALL_NUMBER)
+		{
+			Direction = FVector::UpVector;
+		}
+
+		OutTransforms[s] = FTransform(
+			FQuat::FindBetweenNormals(FVector::UpVector, Direction),
+			0.5f * (Top + Bot),
+			FVector(2.0f * RADIUS / 100.0f, 2.0f * RADIUS / 100.0f, Length / 100.0f)
+		);
 	}
 }
 
 void ABIMPolyLineActor::GenerateMesh(aiMesh* AiMesh)
 {
 	if (BaseMesh || !AiMesh) return;
+
+	FBIMLineBuffers Buffers;
+	BuildLineBuffers(AiMesh, FBIMImportSettings(), Buffers);
+	CreateMeshFromBuffers(Buffers, AiMesh);
+	PlaceAtReference(FBIMOrigin::FromUTM(RefEasting, RefNorthing, RefAltitude));
+}
+
+void ABIMPolyLineActor::BuildLineBuffers(const aiMesh* AiMesh, const FBIMImportSettings& Settings, FBIMLineBuffers& OutBuffers)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_BuildLineBuffers);
+
+	// segments are stored relative to the mesh center, computed in double precision
+	const FBIMOrigin MeshOrigin = FBIMOrigin::FromMeshBounds(AiMesh);
+	OutBuffers.Origin = MeshOrigin;
+	
+	const int32 NumSegments = AiMesh->mNumFaces;
+	TArray<FTubeSegment> Segments;
+	Segments.SetNumUninitialized(NumSegments);
+	OutBuffers.SegmentPoints.SetNumUninitialized(NumSegments * 2);
+	
+	for (int32 f = 0; f < NumSegments; f++)
+	{
+		const aiFace& Face = AiMesh->mFaces[f];
+		const aiVector3D BotVec = AiMesh->mVertices[Face.mIndices[0]];
+		const aiVector3D TopVec = AiMesh->mVertices[Face.mIndices[1]];
+		// centimeter scaling
+		const FVector Top = MeshOrigin.ToLocal(TopVec.x, TopVec.y, TopVec.z);
+		const FVector Bot = MeshOrigin.ToLocal(BotVec.x, BotVec.y, BotVec.z);
+		Segments[f] = MakeTubeSegment(Top, Bot);
+		OutBuffers.SegmentPoints[2 * f] = Bot;
+		OutBuffers.SegmentPoints[2 * f + 1] = Top;
+		OutBuffers.Bounds += Top;
+		OutBuffers.Bounds += Bot;
+	}
+
+	// widest LOD tube, at its widest joint
+	OutBuffers.Bounds = OutBuffers.Bounds.ExpandBy(3.0f * RADIUS * MAX_MITER_SCALE);
+	OutBuffers.MaterialIndex = AiMesh->mMaterialIndex;
+	
+	if (Settings.LineRenderMode == EBIMLineRenderMode::Instanced)
+	{
+		BuildInstanceTransforms(Segments, OutBuffers.InstanceTransforms);
+		return;
+	}
+
+	// For each LOD, create a tube per polyline
+	FTubeChains Chains;
+	BuildTubeChains(Segments, Chains);
+	const int32 NumLODs = FMath::Clamp(Settings.LineLODScreenSizes.Num(), 1, MAX_LINE_LODS);
+	OutBuffers.LODs.SetNum(NumLODs);
+	for (int32 LODIndex = 0; LODIndex < NumLODs; LODIndex++)
+	{
+		FBIMMeshLOD& LOD = OutBuffers.LODs[LODIndex];
+		LOD.ScreenSize = Settings.LineLODScreenSizes.IsValidIndex(LODIndex) ? Settings.LineLODScreenSizes[LODIndex] : 1.0f;
+		FBIMMeshSection& Section = LOD.Sections.AddDefaulted_GetRef();
+
+		switch (LODIndex)
+		{
+		case 0:
+			BuildTubeLOD<LOD0_SECTOR_COUNT, true>(Chains, 1.0f, Section);
+			break;
+		case 1:
+			BuildTubeLOD<LOD1_SECTOR_COUNT, true>(Chains, 2.0f, Section);
+			break;
+		default:
+			BuildTubeLOD<LOD2_SECTOR_COUNT, false>(Chains, 3.0f, Section);
+			break;
+		}
+	}
+}
+
+float ABIMPolyLineActor::GetLineRadius()
+{
+	return RADIUS;
+}
+
+void ABIMPolyLineActor::CreateMeshFromBuffers(const FBIMLineBuffers& Buffers, aiMesh* AiMesh, bool bCollisionTube)
+{
+	// clusters, cache hits and released scenes have no base mesh, the render data is what marks a built actor
+	if (BaseMesh || RenderMemory > 0) return;
+
+	// Instanced mode: no runtime mesh sections, every segment is an instance of the shared cylinder
+	if (Buffers.InstanceTransforms.Num() > 0)
+	{
+		if (!InstanceMesh)
+		{
+			InstanceMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cylinder.Cylinder"));
+		}
+
+		InstancedLines = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, TEXT("Instanced Lines"));
+		InstancedLines->SetupAttachment(GetRootComponent());
+		InstancedLines->SetStaticMesh(InstanceMesh);
+		InstancedLines->SetMaterial(0, Material);
+		InstancedLines->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		InstancedLines->RegisterComponent();
+		InstancedLines->AddInstances(Buffers.InstanceTransforms, false);
+		RenderMemory = Buffers.InstanceTransforms.Num() * static_cast<int64>(sizeof(FInstancedStaticMeshInstanceData));
+		INC_MEMORY_STAT_BY(STAT_BIMRenderMemory, RenderMemory);
+
+		BaseMesh = AiMesh;
+		Origin = Buffers.Origin;
+		return;
+	}
 	
 	// Initialized and Clear RMC
 	GetRuntimeMeshComponent()->Initialize(StaticProvider);
 	StaticProvider->ClearSection(0, 0);
 
-	// Setup 3 LODs
-	FRuntimeMeshLODProperties LOD0 = FRuntimeMeshLODProperties();
-	LOD0.ScreenSize = 1.3f;
-	FRuntimeMeshLODProperties LOD1 = FRuntimeMeshLODProperties();
-	LOD1.ScreenSize = 0.8f;
-	FRuntimeMeshLODProperties LOD2 = FRuntimeMeshLODProperties();
-	LOD2.ScreenSize = 0.3f;
-	StaticProvider->ConfigureLODs({LOD0, LOD1, LOD2});
-	
 	// Set RMC material
 	StaticProvider->SetupMaterialSlot(0, TEXT("BIM Line Material"), Material);
 	
-	TArray<FVector> PositionsLOD0;
-	TArray<FVector> PositionsLOD1;
-	TArray<FVector> PositionsLOD2;
-	TArray<FVector> Normals;
-	TArray<int32> Triangles;
-	TArray<FRuntimeMeshTangent> Tangents;
-	TArray<FVector2D> TexCoords;
-	
-	// For each line, create a cylinder
-	for (unsigned int f = 0; f < AiMesh->mNumFaces; f++)
+	// Create RMC sections from cylinders, one per LOD
+	CreateBIMSections(StaticProvider, Buffers.LODs);
+	LODSectionCounts.Reset();
+	for (const FBIMMeshLOD& LOD : Buffers.LODs)
 	{
-		// Create and store cylinder in buffers
-		const aiFace Face = AiMesh->mFaces[f];
-		const aiVector3D BotVec = AiMesh->mVertices[Face.mIndices[0]];
-		const aiVector3D TopVec = AiMesh->mVertices[Face.mIndices[1]];
-		// centimeter scaling
-		FVector Top = 100.0f * FVector(TopVec.y - RefNorthing, TopVec.x - RefEasting, TopVec.z - RefAltitude);
-		FVector Bot = 100.0f * FVector(BotVec.y - RefNorthing, BotVec.x - RefEasting, BotVec.z - RefAltitude);
-		CreateCylinder(Top, Bot, PositionsLOD0, PositionsLOD1, PositionsLOD2, Normals, Triangles);
+		LODSectionCounts.Add(LOD.Sections.Num());
 	}
-	
-	// Create RMC section from cylinder
-	const TArray<FColor> EmptyColors{};
+	RenderMemory = GetBIMRenderSize(Buffers.LODs);
+	INC_MEMORY_STAT_BY(STAT_BIMRenderMemory, RenderMemory);
+	ElementVertices.Init(Buffers);
 
-	StaticProvider->CreateSectionFromComponents(0, 0, 0, PositionsLOD0, Triangles, Normals, TexCoords, EmptyColors, Tangents, ERuntimeMeshUpdateFrequency::Infrequent, false);
-	StaticProvider->CreateSectionFromComponents(1, 0, 0, PositionsLOD1, Triangles, Normals, TexCoords, EmptyColors, Tangents, ERuntimeMeshUpdateFrequency::Infrequent, false);
-	StaticProvider->CreateSectionFromComponents(2, 0, 0, PositionsLOD2, Triangles, Normals, TexCoords, EmptyColors, Tangents, ERuntimeMeshUpdateFrequency::Infrequent, false);
+	// simplified collision is built from the segments once, only when it was asked for
+	SegmentPoints.Reset();
+	if (bCollisionTube)
+	{
+		SegmentPoints = Buffers.SegmentPoints;
+	}
 	
 	// Set base mesh for future reference (maybe)	
 	BaseMesh = AiMesh;
+	Origin = Buffers.Origin;
+}
+
+void ABIMPolyLineActor::BeginDestroy()
+{
+	DEC_MEMORY_STAT_BY(STAT_BIMRenderMemory, RenderMemory);
+	RenderMemory = 0;
+
+	Super::BeginDestroy();
+}
+
+void ABIMPolyLineActor::PlaceAtReference(const FBIMOrigin& Reference)
+{
+	const FVector Location = Origin - Reference;
+	if (GetActorLocation().Equals(Location)) return;
+
+	// runtime mesh actors are static by default, re-anchoring needs to move them
+	GetRootComponent()->SetMobility(EComponentMobility::Movable);
+	SetActorLocation(Location);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+void ABIMPolyLineActor::SetCollisionMode(EBIMCollisionMode Mode)
+{
+	// instances use the simple collision of the cylinder mesh, nothing to cook
+	if (InstancedLines)
+	{
+		InstancedLines->SetCollisionProfileName(Mode == EBIMCollisionMode::None ? UCollisionProfile::NoCollision_ProfileName : UCollisionProfile::BlockAll_ProfileName);
+		return;
+	}
+	
+	if (Mode == EBIMCollisionMode::None || LODSectionCounts.Num() == 0)
+	{
+		GetRuntimeMeshComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		return;
+	}
+
+	// the coarse render LODs are thicker than the line, so simplified collision gets a tube of its own. Its
+	// segments are freed once it is built: without them, the full resolution tube collides instead
+	FRuntimeMeshCollisionData CollisionMesh;
+	const bool bTube = Mode == EBIMCollisionMode::Simplified && SegmentPoints.Num() > 0;
+	if (bTube)
+	{
+		BuildCollisionTube(CollisionMesh);
+		SegmentPoints.Empty();
+	}
+	StaticProvider->SetCollisionMesh(CollisionMesh);
+
+	EnableBIMCollision(StaticProvider, 0, LODSectionCounts[0]);
+	for (int32 SectionIndex = 0; SectionIndex < LODSectionCounts[0]; SectionIndex++)
+	{
+		StaticProvider->SetRenderableSectionAffectsCollision(SectionIndex, !bTube, SectionIndex == LODSectionCounts[0] - 1);
+	}
+	GetRuntimeMeshComponent()->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+}
+
+void ABIMPolyLineActor::BuildCollisionTube(FRuntimeMeshCollisionData& OutCollision) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_BuildCollisionTube);
+
+	TArray<FTubeSegment> Segments;
+	Segments.SetNumUninitialized(SegmentPoints.Num() / 2);
+	for (int32 s = 0; s < Segments.Num(); s++)
+	{
+		Segments[s] = MakeTubeSegment(SegmentPoints[2 * s + 1], SegmentPoints[2 * s]);
+	}
+
+	FTubeChains Chains;
+	BuildTubeChains(Segments, Chains);
+	FBIMMeshSection Tube;
+	BuildTubeLOD<COLLISION_SECTOR_COUNT, false>(Chains, 1.0f, Tube);
+
+	OutCollision.Vertices.Reserve(Tube.Positions.Num());
+	for (const FVector& Position : Tube.Positions)
+	{
+		OutCollision.Vertices.Add(Position);
+	}
+	OutCollision.Triangles.Reserve(Tube.Triangles.Num() / 3);
+	for (int32 i = 0; i + 2 < Tube.Triangles.Num(); i += 3)
+	{
+		OutCollision.Triangles.Add(Tube.Triangles[i], Tube.Triangles[i + 1], Tube.Triangles[i + 2]);
+	}
+}
+
+bool ABIMPolyLineActor::SetElementColors(const TArray<int32>& Elements, const FLinearColor& Color)
+{
+	// instanced lines have no vertex colors of their own
+	if (ElementVertices.IsEmpty()) return false;
+
+	ElementVertices.SetColor(StaticProvider, Elements, Color.ToFColor(true));
+	return true;
+}
+
 void ABIMPolyLineActor::SetRefs(float Easting, float Northing, float Altitude)
 {
 	RefEasting = Easting;
@@ -161,4 +637,19 @@ void ABIMPolyLineActor::SetMaterial(UMaterialInstance* MaterialInstance)
 	{
 		StaticProvider->SetupMaterialSlot(0, TEXT("BIM Material"), Material);
 	}
+
+	if (InstancedLines)
+	{
+		InstancedLines->SetMaterial(0, Material);
+	}
+}
+
+void ABIMPolyLineActor::SetInstanceMesh(UStaticMesh* Mesh)
+{
+	InstanceMesh = Mesh;
+
+	if (InstancedLines)
+	{
+		InstancedLines->SetStaticMesh(InstanceMesh);
+	}
 }
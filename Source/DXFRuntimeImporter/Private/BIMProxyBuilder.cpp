@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMProxyBuilder.h"
+
+#include "Async/ParallelFor.h"
+#include "BIMImporterStats.h"
+#include "BIMMeshSimplifier.h"
+
+namespace
+{
+	// Merge the coarsest LOD of Members into one section relative to the first member, and simplify it
+	void BuildProxy(const TArray<const FBIMRenderBuffers*>& Members, const FBIMImportSettings& Settings, FBIMProxyBuffers& Out)
+	{
+		// proxies render with the mesh material: normals and baked colors are all they keep
+		const bool bColors = Settings.VertexColorMode != EBIMVertexColorMode::None;
+		Out.Origin = Members[0]->Origin;
+		Out.MaterialIndex = Members[0]->MaterialIndex;
+
+		FBIMMeshSection Merged;
+		for (const FBIMRenderBuffers* Buffers : Members)
+		{
+			const FVector Offset = Buffers->Origin - Out.Origin;
+			for (const FBIMMeshSection& Section : Buffers->LODs.Last().Sections)
+			{
+				const int32 FirstVertex = Merged.Positions.Num();
+				const int32 NumVertices = Section.Positions.Num();
+				for (int32 v = 0; v < NumVertices; v++)
+				{
+					Merged.Positions.Add(Section.Positions[v] + Offset);
+					Merged.Normals.Add(Section.Normals.Num() == NumVertices ? Section.Normals[v] : FPackedNormal(FVector::UpVector));
+					if (bColors)
+					{
+						Merged.Colors.Add(Section.Colors.Num() == NumVertices ? Section.Colors[v] : FColor::White);
+					}
+				}
+				for (const int32 Index : Section.Triangles)
+				{
+					Merged.Triangles.Add(FirstVertex + Index);
+				}
+			}
+		}
+		WeldBIMSection(Merged);
+
+		// kept as merged if it can't be reduced any further
+		const int32 NumTriangles = Merged.Triangles.Num() / 3;
+		const int32 TargetTriangles = FMath::Max(1, FMath::RoundToInt(NumTriangles * Settings.ProxyTrianglePercent));
+		FBIMMeshLOD& LOD = Out.LODs.AddDefaulted_GetRef();
+		FBIMMeshSection& Section = LOD.Sections.AddDefaulted_GetRef();
+		if (!FBIMMeshSimplifier::Simplify(Merged, TargetTriangles, Section))
+		{
+			Section = MoveTemp(Merged);
+		}
+		Out.Bounds = FBox(Section.Positions);
+	}
+}
+
+void FBIMProxyBuilder::Build(const TArray<FBIMMeshBuffers>& MeshBuffers, const TArray<FBIMLineBuffers>& LineBuffers, const FBIMImportSettings& Settings, TArray<FBIMProxyBuffers>& OutProxies)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMBuildProxies);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_BuildProxies);
+
+	TMap<TTuple<FIntVector, int32>, TArray<const FBIMRenderBuffers*>> Tiles;
+	for (const FBIMMeshBuffers& Buffers : MeshBuffers)
+	{
+		if (IsProxied(Buffers)) Tiles.FindOrAdd(GetTile(Buffers, Settings.ProxyTileSize)).Add(&Buffers);
+	}
+	for (const FBIMLineBuffers& Buffers : LineBuffers)
+	{
+		if (IsProxied(Buffers)) Tiles.FindOrAdd(GetTile(Buffers, Settings.ProxyTileSize)).Add(&Buffers);
+	}
+
+	TArray<TPair<TTuple<FIntVector, int32>, TArray<const FBIMRenderBuffers*>>> TileList = Tiles.Array();
+	OutProxies.SetNum(TileList.Num());
+	ParallelFor(TileList.Num(), [&](int32 TileIndex)
+	{
+		OutProxies[TileIndex].Tile = TileList[TileIndex].Key.Get<0>();
+		OutProxies[TileIndex].CategorySet = TileList[TileIndex].Key.Get<1>();
+		BuildProxy(TileList[TileIndex].Value, Settings, OutProxies[TileIndex]);
+	});
+}
+
+TTuple<FIntVector, int32> FBIMProxyBuilder::GetTile(const FBIMRenderBuffers& Buffers, float TileSize)
+{
+	// every element of an actor is in the same layers
+	const int32 CategorySet = Buffers.Elements.Num() > 0 ? Buffers.Elements[0].CategorySet : INDEX_NONE;
+	if (TileSize <= 0.0f) return MakeTuple(FIntVector::ZeroValue, CategorySet);
+
+	// tile of the absolute bounds center, in double precision like clusters
+	const FVector Center = Buffers.Bounds.IsValid ? Buffers.Bounds.GetCenter() : FVector::ZeroVector;
+	const FIntVector Tile(
+		static_cast<int32>(FMath::FloorToDouble((Buffers.Origin.X + Center.X) / TileSize)),
+		static_cast<int32>(FMath::FloorToDouble((Buffers.Origin.Y + Center.Y) / TileSize)),
+		static_cast<int32>(FMath::FloorToDouble((Buffers.Origin.Z + Center.Z) / TileSize))
+	);
+	return MakeTuple(Tile, CategorySet);
+}
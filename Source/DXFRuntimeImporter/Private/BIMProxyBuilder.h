@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMMeshData.h"
+#include "BIMImportSettings.h"
+
+/**
+ * Builds the far-field proxies of a scene: the coarsest LOD of every mesh and tube of a proxy tile merged into
+ * a single section and simplified further, so overviews cost one draw call per tile and layer combination.
+ * Buffers are grouped by the tile containing their bounds center and by their layers, like clusters, so a proxy
+ * can be hidden with its layers. The whole scene is one tile if the tile size is 0. Instanced lines and points
+ * are not part of proxies. Thread-safe
+ */
+class FBIMProxyBuilder
+{
+public:
+	static void Build(const TArray<FBIMMeshBuffers>& MeshBuffers, const TArray<FBIMLineBuffers>& LineBuffers, const FBIMImportSettings& Settings, TArray<FBIMProxyBuffers>& OutProxies);
+
+	// Whether the actor of Buffers is drawn by a proxy from far away: meshes and tubes, which have LODs
+	// (instanced lines and points only get theirs when spawned)
+	static bool IsProxied(const FBIMRenderBuffers& Buffers)
+	{
+		return Buffers.LODs.Num() > 0;
+	}
+
+	// Proxy tile and layer combination of the actor of Buffers
+	static TTuple<FIntVector, int32> GetTile(const FBIMRenderBuffers& Buffers, float TileSize);
+};
@@ -4,19 +4,83 @@
 #include "BIMScene.h"
 
 #include "DXFRuntimeImporter.h"
-#include "HttpModule.h"
-#include "assimp/cimport.h"
-#include "assimp/postprocess.h"
 #include "assimp/DefaultLogger.hpp"
 #include "assimp/Importer.hpp"
-#include "Interfaces/IHttpResponse.h"
+#include "Algo/Count.h"
+#include "Async/Async.h"
+#include "BIMMappedFile.h"
+#include "BIMDownload.h"
+#include "BIMSceneCache.h"
+#include "BIMImportPipeline.h"
+#include "BIMImportProfile.h"
+#include "BIMImporterStats.h"
+#include "BIMProxyBuilder.h"
+#include "BIMSpatialIndex.h"
+#include "BIMTileStore.h"
+#include "Containers/Ticker.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/IQueuedWork.h"
+#include "Misc/Paths.h"
+#include "Misc/QueuedThreadPool.h"
+
+// tiles are released a bit farther than they are loaded, so tiles at the edge don't flicker in and out
+#define STREAMING_UNLOAD_FACTOR 1.25f
+
+// tiles switch back from their proxy a bit nearer than they switch to it, for the same reason
+#define PROXY_RETURN_FACTOR 0.9f
+
+namespace
+{
+	// Local paths and file:// URLs of existing files are read in place, OutPath is the path to read
+	bool GetLocalPath(const FString& Url, FString& OutPath)
+	{
+		OutPath = Url;
+		OutPath.RemoveFromStart(TEXT("file://"));
+		return !Url.StartsWith(TEXT("http://")) && !Url.StartsWith(TEXT("https://")) && FPaths::FileExists(OutPath);
+	}
+
+	// Import queued on a pool that may be destroyed before it runs. Abandoned work moves to the global pool,
+	// so the scene still gets its result and is unrooted
+	class FBIMImportWork : public IQueuedWork
+	{
+	public:
+		explicit FBIMImportWork(TUniqueFunction<void()>&& InFunction)
+			: Function(MoveTemp(InFunction))
+		{
+		}
+
+		virtual void DoThreadedWork() override
+		{
+			Function();
+			delete this;
+		}
+
+		virtual void Abandon() override
+		{
+			if (GThreadPool)
+			{
+				GThreadPool->AddQueuedWork(this);
+			}
+			else
+			{
+				DoThreadedWork();
+			}
+		}
+
+	private:
+		TUniqueFunction<void()> Function;
+	};
+}
 
 /*
  * the world object. I.e. destroying the UBIMScene might not destroy the mesh and line actors.
  */
-UBIMScene* UBIMScene::ImportScene(const FString Path, float RefEasting, float RefNorthing, float RefAltitude, UMaterialInstance* MeshMaterial, UMaterialInstance* LineMaterial, UObject* Outer)
+UBIMScene* UBIMScene::ImportScene(const FString Path, float RefEasting, float RefNorthing, float RefAltitude, UMaterialInstance* MeshMaterial, UMaterialInstance* LineMaterial, UObject* Outer, const FBIMImportSettings& Settings)
 {
-	Assimp::DefaultLogger::set(new UEAssimpStream());
+	// the logger is installed by the module, pick up verbosity changes made since
+	Assimp::DefaultLogger::get()->setLogSeverity(UEAssimpStream::GetSeverity());
 	
 	// Create new scene object and set params
 	UBIMScene* SceneObj = NewObject<UBIMScene>(Outer, StaticClass());
@@ -24,198 +88,1704 @@ UBIMScene* UBIMScene::ImportScene(const FString Path, float RefEasting, float Re
 	SceneObj->RefEasting = RefEasting;
 	SceneObj->RefNorthing = RefNorthing;
 	SceneObj->RefAltitude = RefAltitude;
+	SceneObj->ReferenceOrigin = FBIMOrigin::FromUTM(RefEasting, RefNorthing, RefAltitude);
 	SceneObj->MeshMaterial = MeshMaterial;
 	SceneObj->LineMaterial = LineMaterial;
 	SceneObj->Outer = Outer;
-	
-	// Start processing request for BIM model
-	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
-	Request->OnProcessRequestComplete().BindUObject(SceneObj, &UBIMScene::OnBIMDownloaded);
-	Request->SetVerb(TEXT("GET"));
-	Request->SetURL(Path);
-	Request->ProcessRequest();
+	SceneObj->Settings = Settings;
+	SceneObj->Settings.ImportProfile = FBIMImportProfile::Resolve(Settings.ImportProfile);
 
+	// tiles are the spatial clusters of merged meshes
+	SceneObj->Settings.bMergeMeshes |= Settings.bStreamTiles;
+	SceneObj->BIMUrl = Path;
+	
 	// disable garbage collection while BIM model is downloading
 	SceneObj->AddToRoot();
+	SceneObj->bImporting = true;
+
+	TWeakObjectPtr<UBIMScene> WeakScene(SceneObj);
+	
+	// Local files are imported in place, starting next tick so callers can bind OnSceneReady first
+	FString LocalPath;
+	if (GetLocalPath(Path, LocalPath))
+	{
+		AsyncTask(ENamedThreads::GameThread, [WeakScene, LocalPath]()
+		{
+			if (UBIMScene* Scene = WeakScene.Get())
+			{
+				Scene->ImportFile(LocalPath, false, FBIMSceneCache::GetFileVersion(LocalPath), FString());
+			}
+		});
+		return SceneObj;
+	}
+
+	// Everything else is downloaded to a temporary file first, unless the server's version of it is cached
+	if (Settings.bUseCache)
+	{
+		FBIMDownload::FetchVersion(Path, [WeakScene](const FString& Version)
+		{
+			if (UBIMScene* Scene = WeakScene.Get())
+			{
+				Scene->OnBIMVersionReceived(Version);
+			}
+		});
+	}
+	else
+	{
+		SceneObj->DownloadFile(FString(), FString());
+	}
 	
 	return SceneObj;
 }
 
-void UBIMScene::OnBIMDownloaded(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+bool UBIMScene::Reimport()
+{
+	if (bImporting)
+	{
+		UE_LOG(LogAssimp, Warning, TEXT("%s is still being imported, reimport it once it is ready"), *BIMUrl)
+		return false;
+	}
+
+	// rooted like an import, until the new version is in
+	AddToRoot();
+	bImporting = true;
+	bReimporting = true;
+	ImportReport.DownloadMs = 0.0f;
+	ImportReport.bUnchanged = false;
+
+	// answered on a later tick like ImportScene, so callers can bind OnSceneReady first
+	TWeakObjectPtr<UBIMScene> WeakThis(this);
+	FString LocalPath;
+	if (GetLocalPath(BIMUrl, LocalPath))
+	{
+		const FString Version = FBIMSceneCache::GetFileVersion(LocalPath);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, LocalPath, Version]()
+		{
+			if (UBIMScene* This = WeakThis.Get())
+			{
+				if (!Version.IsEmpty() && Version == This->SourceVersion)
+				{
+					This->FinishUnchanged();
+				}
+				else
+				{
+					This->ImportFile(LocalPath, false, Version, FString());
+				}
+			}
+		});
+		return true;
+	}
+
+	// without an ETag or Last-Modified of the current version, the source is downloaded again
+	DownloadFile(FString(), ServerVersion);
+	return true;
+}
+
+void UBIMScene::FinishUnchanged()
+{
+	UE_LOG(LogAssimp, Log, TEXT("%s is unchanged (%s)"), *BIMUrl, *SourceVersion)
+	ImportReport.bUnchanged = true;
+	bImporting = false;
+	bReimporting = false;
+	RemoveFromRoot();
+	OnSceneReady.Broadcast(this);
+}
+
+void UBIMScene::OnBIMVersionReceived(const FString& Version)
+{
+	// a known version is loaded straight from the cache, without downloading
+	const FString CacheKey = FBIMSceneCache::MakeKey(BIMUrl, Version, Settings);
+	if (Version.IsEmpty() || !FBIMSceneCache::Contains(CacheKey))
+	{
+		DownloadFile(Version, FString());
+		return;
+	}
+
+	UE_LOG(LogAssimp, Log, TEXT("Using cached %s (%s)"), *BIMUrl, *Version)
+	RunImportTask([CacheKey, Version]()
+	{
+		TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe> Result = MakeShared<FBIMImportResult, ESPMode::ThreadSafe>();
+		Result->Version = Version;
+		Result->ServerVersion = Version;
+		const double CacheStart = FPlatformTime::Seconds();
+		Result->bFromCache = FBIMSceneCache::Load(CacheKey, *Result);
+		Result->bCacheFailed = !Result->bFromCache;
+		Result->Report.CacheMs = (FPlatformTime::Seconds() - CacheStart) * 1000.0;
+		return Result;
+	});
+}
+
+void UBIMScene::DownloadFile(const FString& Version, const FString& CurrentVersion)
+{
+	TWeakObjectPtr<UBIMScene> WeakThis(this);
+	const FString DownloadPath = FPaths::CreateTempFilename(*(FPaths::ProjectSavedDir() / TEXT("BIMImporter")), TEXT("Download"), TEXT(".tmp"));
+	DownloadStartTime = FPlatformTime::Seconds();
+	FBIMDownload::Start(BIMUrl, DownloadPath, [WeakThis, DownloadPath, Version](EBIMDownloadResult Result, const FString& ServerVersion)
+	{
+		UBIMScene* This = WeakThis.Get();
+		if (!This) return;
+
+		if (Result == EBIMDownloadResult::NotModified)
+		{
+			This->FinishUnchanged();
+			return;
+		}
+
+		// the version of the response itself when none was asked for first
+		This->OnBIMDownloaded(Result == EBIMDownloadResult::Downloaded, DownloadPath, Version.IsEmpty() ? ServerVersion : Version);
+	}, CurrentVersion);
+}
+
+void UBIMScene::OnBIMDownloaded(bool bWasSuccessful, const FString& FilePath, const FString& Version)
 {
-	if (!bWasSuccessful || !Response.IsValid() || Response->GetContentLength() <= 0)
+	if (!bWasSuccessful)
 	{
 		UE_LOG(LogAssimp, Warning, TEXT("Request unsuccessful"))
+		FailImport(TEXT("Request unsuccessful"));
 		return;	
 	}
-	
-	/*
-	 * Import scene using Assimp, with postprocessing flags
-	 * available Flags: https://assimp.sourceforge.net/lib_html/postprocess_8h.html 
-	 */
-	
-	constexpr unsigned Flags = (
-		aiProcess_GenNormals                |
-		aiProcess_RemoveRedundantMaterials  |
-		aiProcess_SplitLargeMeshes          |
-		aiProcess_Triangulate               |
-		aiProcess_SortByPType               |
-		aiProcess_FindDegenerates           |
-		aiProcess_FindInvalidData           |
-		aiProcess_OptimizeGraph             |
-		aiProcess_OptimizeMeshes            |
-		aiProcess_SplitLargeMeshes
-	);
-	
-	// Read scene from HTTP response buffer and import bim model
-	UE_LOG(LogAssimp, Log, TEXT("Import Begin"))
-	Assimp::Importer *Imp = new Assimp::Importer(); 
-	const void * Buffer = Response->GetContent().GetData();
-	const size_t Length = Response->GetContentLength();
-	// have to provide "glb" as hint to import GLTF files for some reason.
-	// DXF files still work given "glb" as hint, since importer falls back to signature based detection
-	const aiScene* Scene = Imp->ReadFileFromMemory(Buffer, Length, Flags, "glb");
-	UE_LOG(LogAssimp, Log, TEXT("Import End"))
-	
-	if (!Scene)
+
+	ImportReport.DownloadMs = (FPlatformTime::Seconds() - DownloadStartTime) * 1000.0;
+	ImportFile(FilePath, true, Version, Version);
+}
+
+void UBIMScene::ImportFile(const FString& FilePath, bool bTemporary, const FString& Version, const FString& InServerVersion)
+{
+	const FString Source = BIMUrl;
+	const FBIMImportSettings ImportSettings = Settings;
+
+	// Read scene from the memory-mapped file (or the cache) and import bim model
+	RunImportTask([Source, FilePath, bTemporary, Version, InServerVersion, ImportSettings]()
+	{
+		TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe> Result = MakeShared<FBIMImportResult, ESPMode::ThreadSafe>();
+		Result->Version = Version;
+		Result->ServerVersion = InServerVersion;
+		FString CacheKey;
+		{
+			// assimp is done with the input once it returns, unmap before deleting downloads
+			FBIMMappedFile File;
+			if (File.Open(FilePath))
+			{
+				if (ImportSettings.bUseCache)
+				{
+					// without a version from the server, the content itself is the version
+					Result->Version = Version.IsEmpty() ? FBIMSceneCache::GetContentVersion(File.GetData(), File.GetSize()) : Version;
+					CacheKey = FBIMSceneCache::MakeKey(Source, Result->Version, ImportSettings);
+					const double CacheStart = FPlatformTime::Seconds();
+					Result->bFromCache = FBIMSceneCache::Load(CacheKey, *Result);
+					Result->Report.CacheMs = (FPlatformTime::Seconds() - CacheStart) * 1000.0;
+				}
+
+				if (!Result->bFromCache)
+				{
+					// the importer owns the scene, both are freed with the last reference
+					Result->Importer = MakeShared<Assimp::Importer, ESPMode::ThreadSafe>();
+					Result->Scene = FBIMImportPipeline::ReadScene(Result->Importer.Get(), File.GetData(), File.GetSize(), ImportSettings.ImportProfile, Source);
+
+					const FBIMImportTimer* Timer = static_cast<const FBIMImportTimer*>(Result->Importer->GetProgressHandler());
+					Result->Report.ReadMs = Timer->GetReadSeconds() * 1000.0;
+					Result->Report.PostProcessMs = Timer->GetPostProcessSeconds() * 1000.0;
+					for (const TPair<FString, double>& Step : Timer->GetStepSeconds())
+					{
+						Result->Report.PostProcessStepMs.Add(Step.Key, Step.Value * 1000.0);
+					}
+				}
+			}
+		}
+		if (bTemporary)
+		{
+			IFileManager::Get().Delete(*FilePath);
+		}
+		
+		if (Result->Scene)
+		{
+			aiMemoryInfo MemoryInfo;
+			Result->Importer->GetMemoryRequirements(MemoryInfo);
+			Result->SourceBytes = MemoryInfo.total;
+
+			FBIMImportPipeline::SortMeshes(*Result);
+			const double BuildStart = FPlatformTime::Seconds();
+			FBIMImportPipeline::BuildBuffers(Result->Scene, Result->MeshObjs, Result->LineObjs, Result->Categories, Result->MeshBuffers, Result->LineBuffers, ImportSettings);
+			FBIMImportPipeline::BuildPointBuffers(Result->PointObjs, Result->Categories, Result->PointBuffers, ImportSettings);
+			Result->Report.BuildBuffersMs = (FPlatformTime::Seconds() - BuildStart) * 1000.0;
+			if (ImportSettings.bUseCache)
+			{
+				const double CacheStart = FPlatformTime::Seconds();
+				FBIMSceneCache::Save(CacheKey, *Result);
+				Result->Report.CacheMs += (FPlatformTime::Seconds() - CacheStart) * 1000.0;
+			}
+		}
+		return Result;
+	});
+}
+
+void UBIMScene::RunImportTask(TFunction<TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe>()> Task)
+{
+	// the spatial index and proxies are built from the final buffers, whether they come from assimp or the cache
+	const bool bBuildSpatialIndex = Settings.bBuildSpatialIndex;
+	const bool bStreamTiles = Settings.bStreamTiles;
+	const FBIMImportSettings ImportSettings = Settings;
+	auto RunImport = [Task, bBuildSpatialIndex, bStreamTiles, ImportSettings]()
+	{
+		TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe> Result = Task();
+		if (bBuildSpatialIndex && (Result->Scene || Result->bFromCache))
+		{
+			const double IndexStart = FPlatformTime::Seconds();
+			Result->SpatialIndex = MakeShared<FBIMSpatialIndex, ESPMode::ThreadSafe>();
+			Result->SpatialIndex->Build(Result->MeshBuffers, Result->LineBuffers, ABIMPolyLineActor::GetLineRadius());
+			Result->Report.SpatialIndexMs = (FPlatformTime::Seconds() - IndexStart) * 1000.0;
+		}
+		if (ImportSettings.bBuildProxy && (Result->Scene || Result->bFromCache))
+		{
+			const double ProxyStart = FPlatformTime::Seconds();
+			FBIMProxyBuilder::Build(Result->MeshBuffers, Result->LineBuffers, ImportSettings, Result->ProxyBuffers);
+			Result->Report.ProxyMs = (FPlatformTime::Seconds() - ProxyStart) * 1000.0;
+		}
+		FBIMImportPipeline::CountGeometry(*Result);
+
+		// streamed scenes are spawned from the tile store, falling back to spawning everything if it can't be written
+		if (bStreamTiles && (Result->Scene || Result->bFromCache))
+		{
+			const FString StorePath = FPaths::CreateTempFilename(*(FPaths::ProjectSavedDir() / TEXT("BIMImporter") / TEXT("Tiles")), TEXT("Tiles"), TEXT(".bimtiles"));
+			Result->TileStore = MakeShared<FBIMTileStore, ESPMode::ThreadSafe>();
+			if (!Result->TileStore->Write(StorePath, Result->MeshBuffers, Result->LineBuffers))
+			{
+				Result->TileStore.Reset();
+			}
+		}
+		return Result;
+	};
+
+	if (!Settings.bAsyncImport)
+	{
+		OnBIMImported(RunImport());
+		return;
+	}
+
+	// Parse and build buffers on a worker. The scene stays rooted until OnBIMImported, so the weak pointer only guards engine shutdown
+	TWeakObjectPtr<UBIMScene> WeakThis(this);
+	auto RunOnWorker = [WeakThis, RunImport]()
+	{
+		TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe> Result = RunImport();
+		
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Result]()
+		{
+			if (UBIMScene* This = WeakThis.Get())
+			{
+				This->OnBIMImported(Result);
+			}
+		});
+	};
+
+	if (ThreadPool)
+	{
+		ThreadPool->AddQueuedWork(new FBIMImportWork(MoveTemp(RunOnWorker)));
+	}
+	else
+	{
+		Async(EAsyncExecution::ThreadPool, MoveTemp(RunOnWorker));
+	}
+}
+
+void UBIMScene::SetThreadPool(FQueuedThreadPool* Pool)
+{
+	ThreadPool = Pool;
+}
+
+void UBIMScene::OnBIMImported(TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe> Result)
+{
+	// the entry was trimmed or unreadable after all, fall back to the source
+	if (Result->bCacheFailed)
+	{
+		UE_LOG(LogAssimp, Log, TEXT("Cached %s could not be loaded, downloading it"), *BIMUrl)
+		DownloadFile(Result->ServerVersion, FString());
+		return;
+	}
+
+	if (!Result->Scene && !Result->bFromCache)
 	{
 		UE_LOG(LogAssimp, Error, TEXT("BIM failed to import."))
 		GEngine->AddOnScreenDebugMessage(2, 10.0f, FColor::Red, TEXT("There was an error while importing the BIM"));
-		BaseScene = nullptr;
-		RemoveFromRoot();
+		FailImport(TEXT("BIM failed to import"));
 		return;
 	}
+
+	// a reimport replaces the previous version, keeping the actors of everything that didn't change. Streamed
+	// scenes spawn tiles from the new store anyway, they start over
+	const bool bIncremental = bReimporting && !TileStore.IsValid() && !Result->TileStore.IsValid();
+	TMultiMap<uint64, AActor*> Reusable;
+	if (bIncremental)
+	{
+		CollectReusableActors(Reusable);
+	}
+	else if (bReimporting)
+	{
+		ClearActors();
+	}
+	ReleaseSourceData();
 	
-	// Set meshes and lines	
-	for (unsigned int i = 0; i < Scene->mNumMeshes; i++)
+	// Set meshes, lines and their prebuilt buffers
+	this->SourceVersion = Result->Version;
+	this->ServerVersion = Result->ServerVersion;
+	this->Importer = Result->Importer;
+	this->BaseScene = Result->Scene;
+	this->SourceBytes = Result->SourceBytes;
+	this->MeshObjs = MoveTemp(Result->MeshObjs);
+	this->LineObjs = MoveTemp(Result->LineObjs);
+	this->PointObjs = MoveTemp(Result->PointObjs);
+	this->MeshNames = MoveTemp(Result->MeshNames);
+	this->LineNames = MoveTemp(Result->LineNames);
+	this->PointNames = MoveTemp(Result->PointNames);
+	this->MeshBuffers = MoveTemp(Result->MeshBuffers);
+	this->LineBuffers = MoveTemp(Result->LineBuffers);
+	this->PointBuffers = MoveTemp(Result->PointBuffers);
+	this->SpatialIndex = Result->SpatialIndex;
+	this->TileStore = Result->TileStore;
+	this->Categories = MoveTemp(Result->Categories);
+	INC_MEMORY_STAT_BY(STAT_BIMSourceMemory, SourceBytes);
+
+	// actors start out in the state of their layers, and of the proxies standing in for them
+	UpdateHiddenSets();
+	SpawnProxies(Result->ProxyBuffers);
+
+	// the download was timed on the game thread, everything else on the worker
+	const float DownloadMs = ImportReport.DownloadMs;
+	ImportReport = Result->Report;
+	ImportReport.DownloadMs = DownloadMs;
+
+	if (bIncremental)
 	{
-		aiMesh* Obj = Scene->mMeshes[i];
-		if (Obj->mPrimitiveTypes & aiPrimitiveType_LINE)
-		{
-			this->LineObjs.Add(Obj);
-		}
-		else if (Obj->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) // assume triangulated (via flags)
-		{
-			this->MeshObjs.Add(Obj);
-		}
-		// TODO: if point?
+		ReimportActors(Reusable);
+		return;
+	}
+
+	if (TileStore.IsValid())
+	{
+		StartStreaming();
+		FinishSpawn();
+		return;
 	}
 
-	this->BaseScene = Scene;
+	// the scene stays rooted until every actor is spawned
+	if (Settings.bProgressiveSpawn)
+	{
+		StartProgressiveSpawn();
+		return;
+	}
 
+	const double SpawnStart = FPlatformTime::Seconds();
 	SpawnLines();
 	SpawnMeshes();
+	SpawnPoints();
+	ImportReport.SpawnMs = (FPlatformTime::Seconds() - SpawnStart) * 1000.0;
+	FinishSpawn();
+}
 
-	// Remove from root to re-enable garbage collection
+void UBIMScene::FailImport(const FString& Error)
+{
+	// a failed reimport leaves the previous version in place
+	bImporting = false;
+	bReimporting = false;
 	RemoveFromRoot();
+	OnSceneFailed.Broadcast(this, Error);
 }
 
 void UBIMScene::SpawnMeshes()
 {
-	// Spawn meshes
-	for (int i = 0; i < MeshObjs.Num(); i++)
+	if (MeshBuffers.Num() == 0 && MeshObjs.Num() == 0 && MeshActors.Num() > 0)
 	{
-		aiMesh* AiMesh = MeshObjs[i];
-		UE_LOG(LogAssimp, Log, TEXT("Spawning: %s"), UTF8_TO_TCHAR(AiMesh->mName.C_Str()))
-		
-		// Spawn an actor
-		ABIMMeshActor* MeshActor = GetWorld()->SpawnActor<ABIMMeshActor>(
-			FVector(0.0, 0.0,0.0),
-			FRotator(0.0,0.0,0.0));
+		UE_LOG(LogAssimp, Warning, TEXT("Source data of %s was released, meshes can't be spawned again"), *BIMUrl)
+		return;
+	}
 
-		// Add to actor array in scene
-		MeshActor->SetRefs(RefEasting, RefNorthing, RefAltitude);
-		MeshActor->SetMaterial(MeshMaterial);
-		MeshActors.Add(MeshActor);
+	// Buffers are consumed by spawning, rebuild them if spawned again
+	if (MeshBuffers.Num() == 0 && MeshObjs.Num() > 0)
+	{
+		TArray<FBIMLineBuffers> Unused;
+		FBIMImportPipeline::BuildBuffers(BaseScene, MeshObjs, {}, Categories, MeshBuffers, Unused, Settings);
+	}
+	
+	// Spawn meshes, one actor per aiMesh or per cluster
+	for (const FBIMMeshBuffers& Buffers : MeshBuffers)
+	{
+		SpawnMeshActor(Buffers, Elements.Num());
+	}
 
-		// Generate the RMC in spawned actor
-		MeshActor->GenerateMesh(AiMesh);
+	// cached buffers can't be rebuilt without assimp data, keep them for the next spawn
+	if (MeshObjs.Num() > 0)
+	{
+		MeshBuffers.Empty();
 	}
 }
 
 void UBIMScene::SpawnLines()
 {
+	if (LineBuffers.Num() == 0 && LineObjs.Num() == 0 && LineActors.Num() > 0)
+	{
+		UE_LOG(LogAssimp, Warning, TEXT("Source data of %s was released, lines can't be spawned again"), *BIMUrl)
+		return;
+	}
+
+	if (LineBuffers.Num() == 0 && LineObjs.Num() > 0)
+	{
+		TArray<FBIMMeshBuffers> Unused;
+		FBIMImportPipeline::BuildBuffers(BaseScene, {}, LineObjs, Categories, Unused, LineBuffers, Settings);
+	}
+	
 	// Spawn lines (similar to meshes)
-	for (int i = 0; i < LineObjs.Num(); i++)
+	for (const FBIMLineBuffers& Buffers : LineBuffers)
+	{
+		SpawnLineActor(Buffers, Elements.Num());
+	}
+
+	if (LineObjs.Num() > 0)
+	{
+		LineBuffers.Empty();
+	}
+}
+
+void UBIMScene::SpawnPoints()
+{
+	if (PointBuffers.Num() == 0 && PointObjs.Num() == 0 && PointActors.Num() > 0)
 	{
-		aiMesh* AiMesh = LineObjs[i];
-		UE_LOG(LogAssimp, Log, TEXT("Spawning: %s"), UTF8_TO_TCHAR(AiMesh->mName.C_Str()))
+		UE_LOG(LogAssimp, Warning, TEXT("Source data of %s was released, points can't be spawned again"), *BIMUrl)
+		return;
+	}
 
-		ABIMPolyLineActor* LineActor = GetWorld()->SpawnActor<ABIMPolyLineActor>(
-			FVector(0.0f, 0.0f, 0.0f),
-			FRotator(0.0f, 0.0f, 0.0f)
-		);
+	if (PointBuffers.Num() == 0 && PointObjs.Num() > 0)
+	{
+		FBIMImportPipeline::BuildPointBuffers(PointObjs, Categories, PointBuffers, Settings);
+	}
 
-		LineActor->SetRefs(RefEasting, RefNorthing, RefAltitude);
-		LineActor->SetMaterial(LineMaterial);
-		LineActors.Add(LineActor);
+	for (const FBIMPointBuffers& Buffers : PointBuffers)
+	{
+		SpawnPointActor(Buffers, Elements.Num());
+	}
 
-		LineActor->GenerateMesh(AiMesh);
+	if (PointObjs.Num() > 0)
+	{
+		PointBuffers.Empty();
 	}
 }
 
-TArray<ABIMMeshActor*> UBIMScene::GetAllMeshActors()
+ABIMMeshActor* UBIMScene::SpawnMeshActor(const FBIMMeshBuffers& Buffers, int32 FirstElement)
 {
-	return MeshActors;
+	SCOPE_CYCLE_COUNTER(STAT_BIMSpawn);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_SpawnMeshActor);
+
+	const bool bSingle = Buffers.Elements.Num() == 1;
+	aiMesh* AiMesh = bSingle && MeshObjs.Num() > 0 ? MeshObjs[Buffers.Elements[0].SourceIndex] : nullptr;
+	UE_LOG(LogAssimp, Verbose, TEXT("Spawning: %s"), bSingle ? *MeshNames[Buffers.Elements[0].SourceIndex] : *FString::Printf(TEXT("cluster of %d meshes"), Buffers.Elements.Num()))
+	
+	// Spawn an actor
+	ABIMMeshActor* MeshActor = GetWorld()->SpawnActor<ABIMMeshActor>(
+		FVector(0.0, 0.0,0.0),
+		FRotator(0.0,0.0,0.0));
+
+	// Add to actor array in scene
+	MeshActor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+	MeshActor->SetMaterial(MeshMaterial);
+	MeshActors.Add(MeshActor);
+
+	// Create the RMC sections in spawned actor
+	MeshActor->CreateMeshFromBuffers(Buffers, AiMesh);
+	MeshActor->PlaceAtReference(ReferenceOrigin);
+	AddElements(Buffers, MeshNames, MeshActor, false, FirstElement);
+	return MeshActor;
 }
 
-TArray<ABIMPolyLineActor*> UBIMScene::GetAllPolyLines()
+ABIMPolyLineActor* UBIMScene::SpawnLineActor(const FBIMLineBuffers& Buffers, int32 FirstElement)
 {
-	return LineActors;
+	SCOPE_CYCLE_COUNTER(STAT_BIMSpawn);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_SpawnLineActor);
+
+	const bool bSingle = Buffers.Elements.Num() == 1;
+	aiMesh* AiMesh = bSingle && LineObjs.Num() > 0 ? LineObjs[Buffers.Elements[0].SourceIndex] : nullptr;
+	UE_LOG(LogAssimp, Verbose, TEXT("Spawning: %s"), bSingle ? *LineNames[Buffers.Elements[0].SourceIndex] : *FString::Printf(TEXT("cluster of %d lines"), Buffers.Elements.Num()))
+
+	ABIMPolyLineActor* LineActor = GetWorld()->SpawnActor<ABIMPolyLineActor>(
+		FVector(0.0f, 0.0f, 0.0f),
+		FRotator(0.0f, 0.0f, 0.0f)
+	);
+
+	LineActor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+	LineActor->SetMaterial(LineMaterial);
+	LineActor->SetInstanceMesh(Settings.LineInstanceMesh);
+	LineActors.Add(LineActor);
+
+	LineActor->CreateMeshFromBuffers(Buffers, AiMesh, Settings.CollisionMode == EBIMCollisionMode::Simplified);
+	LineActor->PlaceAtReference(ReferenceOrigin);
+	AddElements(Buffers, LineNames, LineActor, true, FirstElement);
+	return LineActor;
 }
 
-void UBIMScene::HideScene()
+ABIMPointCloudActor* UBIMScene::SpawnPointActor(const FBIMPointBuffers& Buffers, int32 FirstElement)
 {
-	for (ABIMMeshActor* Actor : MeshActors)
+	SCOPE_CYCLE_COUNTER(STAT_BIMSpawn);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_SpawnPointActor);
+	UE_LOG(LogAssimp, Verbose, TEXT("Spawning: cell of %d points"), Buffers.NumPoints())
+
+	ABIMPointCloudActor* PointActor = GetWorld()->SpawnActor<ABIMPointCloudActor>(
+		FVector(0.0f, 0.0f, 0.0f),
+		FRotator(0.0f, 0.0f, 0.0f)
+	);
+
+	PointActor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+	PointActor->SetMaterial(LineMaterial);
+	PointActors.Add(PointActor);
+
+	PointActor->CreateMeshFromBuffers(Buffers, Settings);
+	PointActor->PlaceAtReference(ReferenceOrigin);
+	AddElements(Buffers, PointNames, PointActor, false, FirstElement);
+	for (int32 i = FirstElement; i < FirstElement + Buffers.Elements.Num(); i++)
 	{
-		Actor->SetActorHiddenInGame(true);
+		Elements[i].bIsPoint = true;
+	}
+	return PointActor;
+}
+
+void UBIMScene::StartProgressiveSpawn()
+{
+	// element slots are reserved up front, so ids keep matching the spatial index whatever the spawn order
+	SpawnQueue.Reset();
+	int32 FirstElement = Elements.Num();
+	for (int32 i = 0; i < LineBuffers.Num(); i++)
+	{
+		SpawnQueue.Add({ EBIMSpawnKind::Line, i, FirstElement, 0.0f });
+		FirstElement += LineBuffers[i].Elements.Num();
+	}
+	for (int32 i = 0; i < MeshBuffers.Num(); i++)
+	{
+		SpawnQueue.Add({ EBIMSpawnKind::Mesh, i, FirstElement, 0.0f });
+		FirstElement += MeshBuffers[i].Elements.Num();
+	}
+	for (int32 i = 0; i < PointBuffers.Num(); i++)
+	{
+		SpawnQueue.Add({ EBIMSpawnKind::Point, i, FirstElement, 0.0f });
+		FirstElement += PointBuffers[i].Elements.Num();
 	}
+	Elements.SetNum(FirstElement);
+	SpawnTotal = SpawnQueue.Num();
 
-	for (ABIMPolyLineActor* Actor : LineActors)
+	if (SpawnQueue.Num() == 0)
 	{
-		Actor->SetActorHiddenInGame(true);
+		FinishSpawn();
+		return;
 	}
+	SpawnTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBIMScene::TickSpawn));
 }
 
-void UBIMScene::ShowScene()
+bool UBIMScene::TickSpawn(float DeltaTime)
 {
-	for (ABIMMeshActor* Actor : MeshActors)
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_TickSpawn);
+	CSV_SCOPED_TIMING_STAT(BIMImporter, Spawn);
+
+	const double TickStart = FPlatformTime::Seconds();
+	const double Deadline = TickStart + Settings.SpawnBudgetMs / 1000.0;
+	if (!GetWorld())
 	{
-		Actor->SetActorHiddenInGame(false);
+		SpawnTickerHandle.Reset();
+		SpawnQueue.Empty();
+		FailImport(TEXT("World was destroyed while spawning"));
+		return false;
 	}
 
-	for (ABIMPolyLineActor* Actor : LineActors)
+	// the camera moves between frames, so priorities are refreshed every tick. Nearest items end up last, to be popped first
+	const FVector ViewLocation = GetViewLocation();
+	for (FBIMSpawnItem& Item : SpawnQueue)
+	{
+		const FBIMRenderBuffers& Buffers = Item.Kind == EBIMSpawnKind::Line ? static_cast<const FBIMRenderBuffers&>(LineBuffers[Item.BufferIndex])
+			: Item.Kind == EBIMSpawnKind::Point ? static_cast<const FBIMRenderBuffers&>(PointBuffers[Item.BufferIndex])
+			: MeshBuffers[Item.BufferIndex];
+		Item.Distance = Buffers.Bounds.ShiftBy(Buffers.Origin - ReferenceOrigin).ComputeSquaredDistanceToPoint(ViewLocation);
+	}
+	SpawnQueue.Sort([](const FBIMSpawnItem& A, const FBIMSpawnItem& B)
+	{
+		return A.Distance > B.Distance;
+	});
+
+	// at least one actor per frame, then as many as fit in the budget
+	do
+	{
+		SpawnItem(SpawnQueue.Pop(false));
+	}
+	while (SpawnQueue.Num() > 0 && FPlatformTime::Seconds() < Deadline);
+
+	ImportReport.SpawnMs += (FPlatformTime::Seconds() - TickStart) * 1000.0;
+	CSV_CUSTOM_STAT(BIMImporter, SpawnQueue, SpawnQueue.Num(), ECsvCustomStatOp::Set);
+	OnSpawnProgress.Broadcast(this, SpawnTotal - SpawnQueue.Num(), SpawnTotal);
+
+	// returning false removes the ticker
+	if (SpawnQueue.Num() > 0)
 	{
-		Actor->SetActorHiddenInGame(false);
+		return true;
 	}
+	SpawnTickerHandle.Reset();
+	ReleaseSpawnedBuffers();
+	FinishSpawn();
+	return false;
 }
 
-void UBIMScene::BeginDestroy()
+void UBIMScene::SpawnItem(const FBIMSpawnItem& Item)
 {
-	if (BaseScene)
+	if (Item.Kind == EBIMSpawnKind::Line)
 	{
-		// release assimp resources
-		aiReleaseImport(BaseScene);
+		SpawnLineActor(LineBuffers[Item.BufferIndex], Item.FirstElement);
 	}
+	else if (Item.Kind == EBIMSpawnKind::Point)
+	{
+		SpawnPointActor(PointBuffers[Item.BufferIndex], Item.FirstElement);
+	}
+	else
+	{
+		SpawnMeshActor(MeshBuffers[Item.BufferIndex], Item.FirstElement);
+	}
+}
 
-	// null assimp pointers
-	BaseScene = nullptr;
-	MeshObjs.Empty();
-	LineObjs.Empty();
+void UBIMScene::ReleaseSpawnedBuffers()
+{
+	// buffers are consumed like SpawnMeshes / SpawnLines / SpawnPoints do
+	if (MeshObjs.Num() > 0)
+	{
+		MeshBuffers.Empty();
+	}
+	if (LineObjs.Num() > 0)
+	{
+		LineBuffers.Empty();
+	}
+	if (PointObjs.Num() > 0)
+	{
+		PointBuffers.Empty();
+	}
+}
 
-	// hide actors
-	HideScene();
+uint64 UBIMScene::GetActorSignature(EBIMSpawnKind Kind, const TArray<uint64>& GeometryHashes)
+{
+	return CityHash64WithSeed(reinterpret_cast<const char*>(GeometryHashes.GetData()), GeometryHashes.Num() * sizeof(uint64), static_cast<uint64>(Kind));
+}
 
-	// destroy "child" actors
-	for (ABIMMeshActor* Actor : MeshActors)
+void UBIMScene::CollectReusableActors(TMultiMap<uint64, AActor*>& OutActors) const
+{
+	// the element table knows the hashes of every actor's elements, in the order they were built
+	TMap<AActor*, TArray<uint64>> ActorHashes;
+	for (const FBIMElement& Element : Elements)
 	{
-		Actor->Destroy();
+		if (!IsValid(Element.Actor)) continue;
+
+		TArray<uint64>& Hashes = ActorHashes.FindOrAdd(Element.Actor);
+		if (Hashes.Num() <= Element.ActorElement)
+		{
+			Hashes.SetNumZeroed(Element.ActorElement + 1);
+		}
+		Hashes[Element.ActorElement] = static_cast<uint64>(Element.GeometryHash);
 	}
 
-	for (ABIMPolyLineActor* Actor : LineActors)
+	for (const TPair<AActor*, TArray<uint64>>& Actor : ActorHashes)
 	{
-		Actor->Destroy();
+		const EBIMSpawnKind Kind = Actor.Key->IsA<ABIMPolyLineActor>() ? EBIMSpawnKind::Line
+			: Actor.Key->IsA<ABIMPointCloudActor>() ? EBIMSpawnKind::Point
+			: EBIMSpawnKind::Mesh;
+		OutActors.Add(GetActorSignature(Kind, Actor.Value), Actor.Key);
+	}
+}
+
+AActor* UBIMScene::TakeReusableActor(TMultiMap<uint64, AActor*>& Reusable, const FBIMRenderBuffers& Buffers, EBIMSpawnKind Kind)
+{
+	TArray<uint64> Hashes;
+	Hashes.Reserve(Buffers.Elements.Num());
+	for (const FBIMElementRange& Range : Buffers.Elements)
+	{
+		Hashes.Add(Range.GeometryHash);
+	}
+
+	const uint64 Signature = GetActorSignature(Kind, Hashes);
+	AActor* const* Found = Reusable.Find(Signature);
+	if (!Found) return nullptr;
+
+	AActor* Actor = *Found;
+	Reusable.RemoveSingle(Signature, Actor);
+	return Actor;
+}
+
+void UBIMScene::ReimportActors(TMultiMap<uint64, AActor*>& Reusable)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_ReimportActors);
+	const double SpawnStart = FPlatformTime::Seconds();
+
+	// the element table is laid out in spawn order again, matching the new spatial index
+	Elements.Reset();
+	MeshActors.Reset();
+	LineActors.Reset();
+	PointActors.Reset();
+	KeptActors.Reset();
+	SpawnQueue.Reset();
+
+	// kept actors only get their new elements, their sections stay as they are
+	int32 FirstElement = 0;
+	for (int32 i = 0; i < LineBuffers.Num(); i++)
+	{
+		if (ABIMPolyLineActor* Actor = Cast<ABIMPolyLineActor>(TakeReusableActor(Reusable, LineBuffers[i], EBIMSpawnKind::Line)))
+		{
+			LineActors.Add(Actor);
+			KeptActors.Add(Actor);
+			AddElements(LineBuffers[i], LineNames, Actor, true, FirstElement);
+		}
+		else
+		{
+			SpawnQueue.Add({ EBIMSpawnKind::Line, i, FirstElement, 0.0f });
+		}
+		FirstElement += LineBuffers[i].Elements.Num();
+	}
+	for (int32 i = 0; i < MeshBuffers.Num(); i++)
+	{
+		if (ABIMMeshActor* Actor = Cast<ABIMMeshActor>(TakeReusableActor(Reusable, MeshBuffers[i], EBIMSpawnKind::Mesh)))
+		{
+			MeshActors.Add(Actor);
+			KeptActors.Add(Actor);
+			AddElements(MeshBuffers[i], MeshNames, Actor, false, FirstElement);
+		}
+		else
+		{
+			SpawnQueue.Add({ EBIMSpawnKind::Mesh, i, FirstElement, 0.0f });
+		}
+		FirstElement += MeshBuffers[i].Elements.Num();
+	}
+	for (int32 i = 0; i < PointBuffers.Num(); i++)
+	{
+		if (ABIMPointCloudActor* Actor = Cast<ABIMPointCloudActor>(TakeReusableActor(Reusable, PointBuffers[i], EBIMSpawnKind::Point)))
+		{
+			PointActors.Add(Actor);
+			KeptActors.Add(Actor);
+			AddElements(PointBuffers[i], PointNames, Actor, false, FirstElement);
+			for (int32 e = FirstElement; e < FirstElement + PointBuffers[i].Elements.Num(); e++)
+			{
+				Elements[e].bIsPoint = true;
+			}
+		}
+		else
+		{
+			SpawnQueue.Add({ EBIMSpawnKind::Point, i, FirstElement, 0.0f });
+		}
+		FirstElement += PointBuffers[i].Elements.Num();
+	}
+	Elements.SetNum(FirstElement);
+
+	// whatever wasn't taken belongs to the previous version only
+	for (const TPair<uint64, AActor*>& Left : Reusable)
+	{
+		RetiredActors.Add(Left.Value);
+	}
+	ImportReport.ActorsKept = KeptActors.Num();
+
+	SpawnTotal = SpawnQueue.Num();
+	if (Settings.bProgressiveSpawn && SpawnQueue.Num() > 0)
+	{
+		ImportReport.SpawnMs = (FPlatformTime::Seconds() - SpawnStart) * 1000.0;
+		SpawnTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBIMScene::TickSpawn));
+		return;
+	}
+
+	for (const FBIMSpawnItem& Item : SpawnQueue)
+	{
+		SpawnItem(Item);
+	}
+	SpawnQueue.Reset();
+	ReleaseSpawnedBuffers();
+	ImportReport.SpawnMs = (FPlatformTime::Seconds() - SpawnStart) * 1000.0;
+	FinishSpawn();
+}
+
+void UBIMScene::ClearActors()
+{
+	if (SpawnTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(SpawnTickerHandle);
+		SpawnTickerHandle.Reset();
+	}
+	SpawnQueue.Empty();
+
+	if (StreamingTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(StreamingTickerHandle);
+		StreamingTickerHandle.Reset();
+	}
+	TileStates.Empty();
+	TileStore.Reset();
+	StreamedBytes = 0;
+
+	for (ABIMMeshActor* Actor : MeshActors)
+	{
+		Actor->Destroy();
+	}
+	for (ABIMPolyLineActor* Actor : LineActors)
+	{
+		Actor->Destroy();
+	}
+	for (ABIMPointCloudActor* Actor : PointActors)
+	{
+		Actor->Destroy();
+	}
+	MeshActors.Empty();
+	LineActors.Empty();
+	PointActors.Empty();
+	Elements.Empty();
+	CollisionQueue.Empty();
+}
+
+void UBIMScene::FinishSpawn()
+{
+	// everything needed for rendering now lives in the RMC sections
+	if (Settings.bReleaseSourceData)
+	{
+		ReleaseSourceData();
+	}
+
+	// replaced actors stayed visible until their replacements were in
+	for (const TWeakObjectPtr<AActor>& Actor : RetiredActors)
+	{
+		if (Actor.IsValid())
+		{
+			Actor->Destroy();
+		}
+	}
+	ImportReport.ActorsRemoved = RetiredActors.Num();
+	RetiredActors.Empty();
+
+	ImportReport.Actors = MeshActors.Num() + LineActors.Num() + PointActors.Num();
+	ImportReport.Memory = GetMemoryUsage();
+	UE_LOG(LogAssimp, Log, TEXT("Imported %s: %d meshes, %d lines, %d points, %d actors, %d triangles, %.1f MB"), *BIMUrl,
+		ImportReport.Meshes, ImportReport.Lines, ImportReport.Points, ImportReport.Actors, ImportReport.Triangles, ImportReport.Memory.TotalBytes / (1024.0 * 1024.0))
+	if (bReimporting)
+	{
+		UE_LOG(LogAssimp, Log, TEXT("Reimported %s (%s): %d actors kept, %d spawned, %d removed"), *BIMUrl, *SourceVersion,
+			ImportReport.ActorsKept, ImportReport.Actors - ImportReport.ActorsKept, ImportReport.ActorsRemoved)
+	}
+
+	// Remove from root to re-enable garbage collection
+	bImporting = false;
+	bReimporting = false;
+	RemoveFromRoot();
+
+	// collision arrives progressively after the scene is shown. Kept actors have theirs already
+	if (Settings.CollisionMode != EBIMCollisionMode::None)
+	{
+		if (KeptActors.Num() == 0)
+		{
+			QueueCollision();
+		}
+		else
+		{
+			for (ABIMMeshActor* Actor : MeshActors)
+			{
+				if (!KeptActors.Contains(Actor)) QueueActorCollision(Actor);
+			}
+			for (ABIMPolyLineActor* Actor : LineActors)
+			{
+				if (!KeptActors.Contains(Actor)) QueueActorCollision(Actor);
+			}
+		}
+	}
+	KeptActors.Empty();
+
+	OnSceneReady.Broadcast(this);
+}
+
+void UBIMScene::StartStreaming()
+{
+	// the element table is complete from the start, actors are filled in as tiles load
+	const TArray<FBIMTile>& Tiles = TileStore->GetTiles();
+	int32 TileIndex = 0;
+	for (const FBIMLineBuffers& Buffers : LineBuffers)
+	{
+		AddElements(Buffers, LineNames, nullptr, true, Tiles[TileIndex++].FirstElement);
+	}
+	for (const FBIMMeshBuffers& Buffers : MeshBuffers)
+	{
+		AddElements(Buffers, MeshNames, nullptr, false, Tiles[TileIndex++].FirstElement);
+	}
+
+	// point clouds are a fraction of the size of tiles, they are spawned once and never streamed
+	SpawnPoints();
+
+	// the tile store is the source from now on
+	ReleaseSourceData();
+
+	TileStates.SetNum(Tiles.Num());
+	StreamedBytes = 0;
+	StreamingTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBIMScene::TickStreaming));
+}
+
+bool UBIMScene::TickStreaming(float DeltaTime)
+{
+	if (!GetWorld())
+	{
+		StreamingTickerHandle.Reset();
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_BIMStreaming);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_TickStreaming);
+	CSV_SCOPED_TIMING_STAT(BIMImporter, Streaming);
+
+	const double Deadline = FPlatformTime::Seconds() + Settings.SpawnBudgetMs / 1000.0;
+	const FVector ViewLocation = GetViewLocation();
+	const float LoadDistanceSquared = FMath::Square(Settings.StreamingDistance);
+	const float UnloadDistanceSquared = FMath::Square(Settings.StreamingDistance * STREAMING_UNLOAD_FACTOR);
+	const int64 MemoryLimit = static_cast<int64>(Settings.StreamingMemoryLimitMB) * 1024 * 1024;
+
+	// (squared distance, tile) of tiles to load, and of loaded tiles that may make room for them
+	TArray<TPair<float, int32>> ToLoad;
+	TArray<TPair<float, int32>> Loaded;
+	const TArray<FBIMTile>& Tiles = TileStore->GetTiles();
+	for (int32 i = 0; i < Tiles.Num(); i++)
+	{
+		const FBIMTile& Tile = Tiles[i];
+		const float DistanceSquared = Tile.Bounds.ShiftBy(Tile.Origin - ReferenceOrigin).ComputeSquaredDistanceToPoint(ViewLocation);
+		if (TileStates[i].bLoaded)
+		{
+			if (DistanceSquared > UnloadDistanceSquared)
+			{
+				UnloadTile(i);
+			}
+			else
+			{
+				Loaded.Emplace(DistanceSquared, i);
+			}
+		}
+		else if (DistanceSquared <= LoadDistanceSquared && !TileStates[i].bBroken)
+		{
+			ToLoad.Emplace(DistanceSquared, i);
+		}
+	}
+
+	// nearest tiles load first, farthest loaded tiles are evicted first
+	ToLoad.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+	Loaded.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key > B.Key; });
+
+	int32 Evicted = 0;
+	for (const TPair<float, int32>& Candidate : ToLoad)
+	{
+		if (FPlatformTime::Seconds() >= Deadline) break;
+
+		const int64 TileBytes = Tiles[Candidate.Value].RenderBytes;
+		while (StreamedBytes + TileBytes > MemoryLimit && Evicted < Loaded.Num() && Loaded[Evicted].Key > Candidate.Key)
+		{
+			UnloadTile(Loaded[Evicted++].Value);
+		}
+
+		// everything still loaded is nearer than this tile
+		if (StreamedBytes + TileBytes > MemoryLimit) break;
+
+		LoadTile(Candidate.Value);
+	}
+
+	CSV_CUSTOM_STAT(BIMImporter, LoadedTiles, Algo::CountIf(TileStates, [](const FBIMTileState& State) { return State.bLoaded; }), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(BIMImporter, StreamedMB, StreamedBytes / (1024.0f * 1024.0f), ECsvCustomStatOp::Set);
+	return true;
+}
+
+void UBIMScene::LoadTile(int32 TileIndex)
+{
+	const FBIMTile& Tile = TileStore->GetTiles()[TileIndex];
+	FBIMTileState& State = TileStates[TileIndex];
+
+	AActor* Actor = nullptr;
+	if (Tile.bIsLine)
+	{
+		FBIMLineBuffers Buffers;
+		if (TileStore->LoadTile(TileIndex, Buffers))
+		{
+			Actor = SpawnLineActor(Buffers, Tile.FirstElement);
+		}
+	}
+	else
+	{
+		FBIMMeshBuffers Buffers;
+		if (TileStore->LoadTile(TileIndex, Buffers))
+		{
+			Actor = SpawnMeshActor(Buffers, Tile.FirstElement);
+		}
+	}
+
+	if (!Actor)
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Could not load tile %d of %s"), TileIndex, *BIMUrl)
+		State.bBroken = true;
+		return;
+	}
+
+	State.Actor = Actor;
+	State.bLoaded = true;
+	StreamedBytes += Tile.RenderBytes;
+
+	if (Settings.CollisionMode != EBIMCollisionMode::None)
+	{
+		QueueActorCollision(Actor);
+	}
+}
+
+void UBIMScene::UnloadTile(int32 TileIndex)
+{
+	const FBIMTile& Tile = TileStore->GetTiles()[TileIndex];
+	FBIMTileState& State = TileStates[TileIndex];
+	AActor* Actor = State.Actor.Get();
+
+	State.Actor.Reset();
+	State.bLoaded = false;
+	StreamedBytes -= Tile.RenderBytes;
+
+	for (int32 i = Tile.FirstElement; i < Tile.FirstElement + Tile.NumElements; i++)
+	{
+		Elements[i].Actor = nullptr;
+	}
+
+	if (!Actor) return;
+	ProxiedActors.Remove(Actor);
+	MeshActors.Remove(Cast<ABIMMeshActor>(Actor));
+	LineActors.Remove(Cast<ABIMPolyLineActor>(Actor));
+	Actor->Destroy();
+}
+
+FVector UBIMScene::GetViewLocation() const
+{
+	FVector ViewLocation = FVector::ZeroVector;
+	UWorld* World = GetWorld();
+	if (APlayerController* Controller = World ? World->GetFirstPlayerController() : nullptr)
+	{
+		FRotator ViewRotation;
+		Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+	}
+	return ViewLocation;
+}
+
+void UBIMScene::AddElements(const FBIMRenderBuffers& Buffers, const TArray<FString>& Names, AActor* Actor, bool bIsLine, int32 FirstElement)
+{
+	if (Elements.Num() < FirstElement + Buffers.Elements.Num())
+	{
+		Elements.SetNum(FirstElement + Buffers.Elements.Num());
+	}
+
+	// element bounds are kept in world space
+	const FVector Offset = Buffers.Origin - ReferenceOrigin;
+	for (int32 i = 0; i < Buffers.Elements.Num(); i++)
+	{
+		const FBIMElementRange& Range = Buffers.Elements[i];
+		FBIMElement& Element = Elements[FirstElement + i];
+		Element.Name = Names[Range.SourceIndex];
+		Element.Actor = Actor;
+		Element.bIsLine = bIsLine;
+		Element.ActorElement = i;
+		Element.SectionIndex = Range.SectionIndex;
+		Element.FirstIndex = Range.FirstIndex;
+		Element.NumIndices = Range.NumIndices;
+		Element.Bounds = Range.Bounds.ShiftBy(Offset);
+		Element.GeometryHash = static_cast<int64>(Range.GeometryHash);
+		Element.CategorySet = Range.CategorySet;
+	}
+
+	// every element of an actor is in the same layers, and the actor in one proxy tile
+	if (Actor && Buffers.Elements.Num() > 0)
+	{
+		if (ProxyTiles.Num() > 0 && FBIMProxyBuilder::IsProxied(Buffers))
+		{
+			if (const int32* Tile = ProxyTileIndices.Find(FBIMProxyBuilder::GetTile(Buffers, Settings.ProxyTileSize)))
+			{
+				ProxiedActors.Add(Actor, *Tile);
+			}
+		}
+
+		const bool bHidden = IsActorHidden(Actor, Buffers.Elements[0].CategorySet);
+		if (Actor->IsHidden() != bHidden)
+		{
+			Actor->SetActorHiddenInGame(bHidden);
+		}
+	}
+}
+
+void UBIMScene::SetReference(float Easting, float Northing, float Altitude)
+{
+	RefEasting = Easting;
+	RefNorthing = Northing;
+	RefAltitude = Altitude;
+	SetReferenceOrigin(FBIMOrigin::FromUTM(Easting, Northing, Altitude));
+}
+
+void UBIMScene::SetReferenceOrigin(const FBIMOrigin& Reference)
+{
+	// moving the reference only moves actors, vertices stay untouched
+	const FVector Shift = ReferenceOrigin - Reference;
+	ReferenceOrigin = Reference;
+
+	for (ABIMMeshActor* Actor : MeshActors)
+	{
+		Actor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+		Actor->PlaceAtReference(ReferenceOrigin);
+	}
+
+	for (ABIMPolyLineActor* Actor : LineActors)
+	{
+		Actor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+		Actor->PlaceAtReference(ReferenceOrigin);
+	}
+
+	for (ABIMPointCloudActor* Actor : PointActors)
+	{
+		Actor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+		Actor->PlaceAtReference(ReferenceOrigin);
+	}
+
+	for (const FBIMProxyTile& Tile : ProxyTiles)
+	{
+		if (ABIMMeshActor* Actor = Tile.Actor.Get())
+		{
+			Actor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+			Actor->PlaceAtReference(ReferenceOrigin);
+		}
+	}
+
+	for (FBIMElement& Element : Elements)
+	{
+		// slots reserved for actors still to spawn have no bounds yet
+		if (Element.Bounds.IsValid)
+		{
+			Element.Bounds = Element.Bounds.ShiftBy(Shift);
+		}
+	}
+}
+
+bool UBIMScene::Raycast(const FVector& Start, const FVector& End, FBIMHitResult& OutHit)
+{
+	if (!SpatialIndex.IsValid()) return false;
+
+	// queries run relative to the index origin
+	const FVector Shift = ReferenceOrigin - SpatialIndex->GetOrigin();
+	FBIMSpatialIndex::FHit Hit;
+	if (!SpatialIndex->Raycast(Start + Shift, End + Shift, Hit) || !Elements.IsValidIndex(Hit.Element)) return false;
+
+	OutHit.Element = Elements[Hit.Element];
+	OutHit.Location = Hit.Location - Shift;
+	OutHit.Normal = Hit.Normal;
+	OutHit.Distance = Hit.Distance;
+	return true;
+}
+
+TArray<FBIMElement> UBIMScene::QueryBox(const FBox& Box)
+{
+	TArray<FBIMElement> Found;
+	if (!SpatialIndex.IsValid()) return Found;
+
+	TArray<int32> Ids;
+	SpatialIndex->QueryBox(Box.ShiftBy(ReferenceOrigin - SpatialIndex->GetOrigin()), Ids);
+	for (const int32 Id : Ids)
+	{
+		if (Elements.IsValidIndex(Id))
+		{
+			Found.Add(Elements[Id]);
+		}
+	}
+	return Found;
+}
+
+bool UBIMScene::NearestElement(const FVector& Location, float MaxDistance, FBIMHitResult& OutHit)
+{
+	if (!SpatialIndex.IsValid()) return false;
+
+	const FVector Shift = ReferenceOrigin - SpatialIndex->GetOrigin();
+	FBIMSpatialIndex::FHit Hit;
+	if (!SpatialIndex->Nearest(Location + Shift, MaxDistance, Hit) || !Elements.IsValidIndex(Hit.Element)) return false;
+
+	OutHit.Element = Elements[Hit.Element];
+	OutHit.Location = Hit.Location - Shift;
+	OutHit.Normal = Hit.Normal;
+	OutHit.Distance = Hit.Distance;
+	return true;
+}
+
+void UBIMScene::SetCollisionMode(EBIMCollisionMode Mode)
+{
+	Settings.CollisionMode = Mode;
+	QueueCollision();
+}
+
+void UBIMScene::QueueCollision()
+{
+	CollisionQueue.Reset();
+	for (ABIMMeshActor* Actor : MeshActors)
+	{
+		QueueActorCollision(Actor);
+	}
+	for (ABIMPolyLineActor* Actor : LineActors)
+	{
+		QueueActorCollision(Actor);
+	}
+}
+
+void UBIMScene::QueueActorCollision(AActor* Actor)
+{
+	CollisionQueue.Emplace(Actor, Actor->GetComponentsBoundingBox(true));
+	if (!CollisionTickerHandle.IsValid())
+	{
+		CollisionTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBIMScene::TickCollision));
+	}
+}
+
+bool UBIMScene::TickCollision(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMCollision);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_TickCollision);
+	CSV_SCOPED_TIMING_STAT(BIMImporter, Collision);
+
+	// actors nearest to the player's view go first
+	const FVector ViewLocation = GetViewLocation();
+
+	const int32 Count = FMath::Min(Settings.CollisionActorsPerTick, CollisionQueue.Num());
+	for (int32 i = 0; i < Count; i++)
+	{
+		int32 Nearest = i;
+		float NearestDistance = MAX_flt;
+		for (int32 j = i; j < CollisionQueue.Num(); j++)
+		{
+			const float Distance = CollisionQueue[j].Value.ComputeSquaredDistanceToPoint(ViewLocation);
+			if (Distance < NearestDistance)
+			{
+				Nearest = j;
+				NearestDistance = Distance;
+			}
+		}
+		CollisionQueue.Swap(i, Nearest);
+
+		AActor* Actor = CollisionQueue[i].Key.Get();
+		if (ABIMMeshActor* MeshActor = Cast<ABIMMeshActor>(Actor))
+		{
+			MeshActor->SetCollisionMode(Settings.CollisionMode);
+		}
+		else if (ABIMPolyLineActor* LineActor = Cast<ABIMPolyLineActor>(Actor))
+		{
+			LineActor->SetCollisionMode(Settings.CollisionMode);
+		}
+	}
+	CollisionQueue.RemoveAt(0, Count, false);
+	CSV_CUSTOM_STAT(BIMImporter, CollisionQueue, CollisionQueue.Num(), ECsvCustomStatOp::Set);
+
+	// returning false removes the ticker
+	if (CollisionQueue.Num() == 0)
+	{
+		CollisionTickerHandle.Reset();
+		return false;
+	}
+	return true;
+}
+
+void UBIMScene::SetElementColor(const TArray<FBIMElement>& Targets, FLinearColor Color)
+{
+	// grouped by actor, so every section is re-uploaded once
+	TMap<AActor*, TArray<int32>> ByActor;
+	for (const FBIMElement& Element : Targets)
+	{
+		if (IsValid(Element.Actor))
+		{
+			ByActor.FindOrAdd(Element.Actor).Add(Element.ActorElement);
+		}
+	}
+
+	for (const TPair<AActor*, TArray<int32>>& Group : ByActor)
+	{
+		bool bColored = false;
+		if (ABIMMeshActor* MeshActor = Cast<ABIMMeshActor>(Group.Key))
+		{
+			bColored = MeshActor->SetElementColors(Group.Value, Color);
+		}
+		else if (ABIMPolyLineActor* LineActor = Cast<ABIMPolyLineActor>(Group.Key))
+		{
+			bColored = LineActor->SetElementColors(Group.Value, Color);
+		}
+		// point clouds have no vertex colors
+
+		if (!bColored)
+		{
+			UE_LOG(LogAssimp, Warning, TEXT("%s has no baked vertex colors, import with a VertexColorMode to recolor elements"), *Group.Key->GetName())
+		}
+	}
+}
+
+void UBIMScene::SetLayerVisible(const FString& Layer, bool bVisible)
+{
+	SetLayersVisible({ Layer }, bVisible);
+}
+
+void UBIMScene::SetLayersVisible(const TArray<FString>& Layers, bool bVisible)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_SetLayersVisible);
+
+	for (const FString& Layer : Layers)
+	{
+		if (bVisible)
+		{
+			HiddenLayers.Remove(Layer);
+		}
+		else
+		{
+			HiddenLayers.Add(Layer);
+		}
+	}
+	UpdateHiddenSets();
+	UpdateVisibility();
+}
+
+bool UBIMScene::IsLayerVisible(const FString& Layer) const
+{
+	return !HiddenLayers.Contains(Layer);
+}
+
+TArray<FString> UBIMScene::GetLayers() const
+{
+	return Categories.Names;
+}
+
+TArray<FString> UBIMScene::GetElementLayers(const FBIMElement& Element) const
+{
+	TArray<FString> Layers;
+	if (Categories.Sets.IsValidIndex(Element.CategorySet))
+	{
+		for (const int32 Index : Categories.Sets[Element.CategorySet])
+		{
+			Layers.Add(Categories.Names[Index]);
+		}
+	}
+	return Layers;
+}
+
+void UBIMScene::UpdateHiddenSets()
+{
+	// one lookup per layer name, then one bit test per layer of every combination
+	TBitArray<> HiddenNames(false, Categories.Names.Num());
+	if (HiddenLayers.Num() > 0)
+	{
+		for (int32 i = 0; i < Categories.Names.Num(); i++)
+		{
+			HiddenNames[i] = HiddenLayers.Contains(Categories.Names[i]);
+		}
+	}
+
+	HiddenSets.Init(false, Categories.Sets.Num());
+	for (int32 SetIndex = 0; SetIndex < Categories.Sets.Num(); SetIndex++)
+	{
+		for (const int32 Index : Categories.Sets[SetIndex])
+		{
+			if (HiddenNames.IsValidIndex(Index) && HiddenNames[Index])
+			{
+				HiddenSets[SetIndex] = true;
+				break;
+			}
+		}
+	}
+}
+
+void UBIMScene::UpdateVisibility()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_UpdateVisibility);
+
+	// the first element of an actor stands for all of them, actors already in the right state are left alone
+	for (const FBIMElement& Element : Elements)
+	{
+		if (Element.ActorElement != 0 || !IsValid(Element.Actor)) continue;
+
+		const bool bHidden = IsActorHidden(Element.Actor, Element.CategorySet);
+		if (Element.Actor->IsHidden() != bHidden)
+		{
+			Element.Actor->SetActorHiddenInGame(bHidden);
+		}
+	}
+
+	// proxies stand in for one layer combination of their tile, and are hidden with it
+	for (const FBIMProxyTile& Tile : ProxyTiles)
+	{
+		ABIMMeshActor* Proxy = Tile.Actor.Get();
+		const bool bHidden = IsSetHidden(Tile.CategorySet) || !Tile.bShowProxy;
+		if (Proxy && Proxy->IsHidden() != bHidden)
+		{
+			Proxy->SetActorHiddenInGame(bHidden);
+		}
+	}
+}
+
+bool UBIMScene::IsActorHidden(AActor* Actor, int32 CategorySet) const
+{
+	if (IsSetHidden(CategorySet)) return true;
+
+	const int32* Tile = ProxiedActors.Find(Actor);
+	return Tile && ProxyTiles[*Tile].bShowProxy;
+}
+
+void UBIMScene::SpawnProxies(TArray<FBIMProxyBuffers>& Buffers)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMSpawn);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_SpawnProxies);
+
+	ClearProxies();
+	if (Buffers.Num() == 0) return;
+
+	for (const FBIMProxyBuffers& Proxy : Buffers)
+	{
+		ABIMMeshActor* Actor = GetWorld()->SpawnActor<ABIMMeshActor>(FVector::ZeroVector, FRotator::ZeroRotator);
+		Actor->SetRefs(RefEasting, RefNorthing, RefAltitude);
+		Actor->SetMaterial(MeshMaterial);
+		Actor->CreateMeshFromBuffers(Proxy, nullptr);
+		Actor->PlaceAtReference(ReferenceOrigin);
+
+		// proxies are never queried or collided with, and stay hidden until the view is far enough
+		Actor->SetCollisionMode(EBIMCollisionMode::None);
+		Actor->SetActorHiddenInGame(true);
+
+		ProxyTileIndices.Add(MakeTuple(Proxy.Tile, Proxy.CategorySet), ProxyTiles.Num());
+		FBIMProxyTile& Tile = ProxyTiles.AddDefaulted_GetRef();
+		Tile.Actor = Actor;
+		Tile.Origin = Proxy.Origin;
+		Tile.Bounds = Proxy.Bounds;
+		Tile.CategorySet = Proxy.CategorySet;
+	}
+	Buffers.Empty();
+
+	ProxyTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBIMScene::TickProxies));
+}
+
+void UBIMScene::ClearProxies()
+{
+	if (ProxyTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(ProxyTickerHandle);
+		ProxyTickerHandle.Reset();
+	}
+
+	for (const FBIMProxyTile& Tile : ProxyTiles)
+	{
+		if (ABIMMeshActor* Actor = Tile.Actor.Get())
+		{
+			Actor->Destroy();
+		}
+	}
+	ProxyTiles.Empty();
+	ProxyTileIndices.Empty();
+	ProxiedActors.Empty();
+}
+
+bool UBIMScene::TickProxies(float DeltaTime)
+{
+	if (!GetWorld())
+	{
+		ProxyTickerHandle.Reset();
+		return false;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_TickProxies);
+
+	// a handful of tiles, actors are only touched when one of them switches
+	const FVector ViewLocation = GetViewLocation();
+	const float ShowDistanceSquared = FMath::Square(Settings.ProxyDistance);
+	const float ReturnDistanceSquared = FMath::Square(Settings.ProxyDistance * PROXY_RETURN_FACTOR);
+	bool bChanged = false;
+	for (FBIMProxyTile& Tile : ProxyTiles)
+	{
+		const float DistanceSquared = Tile.Bounds.ShiftBy(Tile.Origin - ReferenceOrigin).ComputeSquaredDistanceToPoint(ViewLocation);
+		const bool bShowProxy = DistanceSquared > (Tile.bShowProxy ? ReturnDistanceSquared : ShowDistanceSquared);
+		if (bShowProxy != Tile.bShowProxy)
+		{
+			Tile.bShowProxy = bShowProxy;
+			bChanged = true;
+		}
+	}
+
+	if (bChanged)
+	{
+		UpdateVisibility();
+	}
+	return true;
+}
+
+FBIMSceneMemory UBIMScene::GetMemoryUsage() const
+{
+	FBIMSceneMemory Memory;
+	Memory.SourceBytes = SourceBytes;
+
+	SIZE_T MeshDataBytes = MeshBuffers.GetAllocatedSize() + LineBuffers.GetAllocatedSize() + PointBuffers.GetAllocatedSize() + Elements.GetAllocatedSize();
+	MeshDataBytes += Categories.GetAllocatedSize() + HiddenSets.GetAllocatedSize();
+	for (const FBIMMeshBuffers& Buffers : MeshBuffers)
+	{
+		MeshDataBytes += Buffers.GetAllocatedSize();
+	}
+	for (const FBIMLineBuffers& Buffers : LineBuffers)
+	{
+		MeshDataBytes += Buffers.GetAllocatedSize();
+	}
+	for (const FBIMPointBuffers& Buffers : PointBuffers)
+	{
+		MeshDataBytes += Buffers.GetAllocatedSize();
+	}
+	for (const FBIMElement& Element : Elements)
+	{
+		MeshDataBytes += Element.Name.GetAllocatedSize();
+	}
+	if (SpatialIndex.IsValid())
+	{
+		MeshDataBytes += SpatialIndex->GetAllocatedSize();
+	}
+	if (TileStore.IsValid())
+	{
+		MeshDataBytes += TileStore->GetAllocatedSize() + TileStates.GetAllocatedSize();
+	}
+	MeshDataBytes += ProxyTiles.GetAllocatedSize() + ProxyTileIndices.GetAllocatedSize() + ProxiedActors.GetAllocatedSize();
+	Memory.MeshDataBytes = MeshDataBytes;
+
+	for (const ABIMMeshActor* Actor : MeshActors)
+	{
+		Memory.RenderBytes += IsValid(Actor) ? Actor->GetRenderMemory() : 0;
+	}
+	for (const ABIMPolyLineActor* Actor : LineActors)
+	{
+		Memory.RenderBytes += IsValid(Actor) ? Actor->GetRenderMemory() : 0;
+	}
+	for (const ABIMPointCloudActor* Actor : PointActors)
+	{
+		Memory.RenderBytes += IsValid(Actor) ? Actor->GetRenderMemory() : 0;
+	}
+	for (const FBIMProxyTile& Tile : ProxyTiles)
+	{
+		Memory.RenderBytes += Tile.Actor.IsValid() ? Tile.Actor->GetRenderMemory() : 0;
+	}
+
+	Memory.TotalBytes = Memory.SourceBytes + Memory.MeshDataBytes + Memory.RenderBytes;
+	return Memory;
+}
+
+void UBIMScene::ReleaseSourceData()
+{
+	// nothing may point into the assimp scene once the importer is gone
+	for (ABIMMeshActor* Actor : MeshActors)
+	{
+		if (IsValid(Actor)) Actor->ReleaseBaseMesh();
+	}
+	for (ABIMPolyLineActor* Actor : LineActors)
+	{
+		if (IsValid(Actor)) Actor->ReleaseBaseMesh();
+	}
+	MeshObjs.Empty();
+	LineObjs.Empty();
+	PointObjs.Empty();
+	BaseScene = nullptr;
+	Importer.Reset();
+	DEC_MEMORY_STAT_BY(STAT_BIMSourceMemory, SourceBytes);
+	SourceBytes = 0;
+
+	MeshBuffers.Empty();
+	LineBuffers.Empty();
+	PointBuffers.Empty();
+}
+
+TArray<FBIMElement> UBIMScene::GetAllElements()
+{
+	return Elements;
+}
+
+TArray<FBIMElement> UBIMScene::FindElementsByName(const FString& Name)
+{
+	return Elements.FilterByPredicate([&Name](const FBIMElement& Element)
+	{
+		return Element.Name == Name;
+	});
+}
+
+TArray<FBIMElement> UBIMScene::GetElementsOfActor(AActor* Actor)
+{
+	return Elements.FilterByPredicate([Actor](const FBIMElement& Element)
+	{
+		return Element.Actor == Actor;
+	});
+}
+
+TArray<ABIMMeshActor*> UBIMScene::GetAllMeshActors()
+{
+	return MeshActors;
+}
+
+TArray<ABIMPolyLineActor*> UBIMScene::GetAllPolyLines()
+{
+	return LineActors;
+}
+
+TArray<ABIMPointCloudActor*> UBIMScene::GetAllPointClouds()
+{
+	return PointActors;
+}
+
+void UBIMScene::HideScene()
+{
+	bSceneHidden = true;
+	UpdateVisibility();
+}
+
+void UBIMScene::ShowScene()
+{
+	// actors of hidden layers stay hidden
+	bSceneHidden = false;
+	UpdateVisibility();
+}
+
+void UBIMScene::BeginDestroy()
+{
+	if (CollisionTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(CollisionTickerHandle);
+		CollisionTickerHandle.Reset();
+	}
+	CollisionQueue.Empty();
+
+	if (SpawnTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(SpawnTickerHandle);
+		SpawnTickerHandle.Reset();
+	}
+	SpawnQueue.Empty();
+
+	if (StreamingTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(StreamingTickerHandle);
+		StreamingTickerHandle.Reset();
+	}
+	TileStates.Empty();
+	TileStore.Reset();
+
+	ClearProxies();
+
+	// release assimp resources, the scene belongs to the importer
+	ReleaseSourceData();
+
+	// hide actors
+	HideScene();
+
+	// destroy "child" actors
+	for (ABIMMeshActor* Actor : MeshActors)
+	{
+		Actor->Destroy();
+	}
+
+	for (ABIMPolyLineActor* Actor : LineActors)
+	{
+		Actor->Destroy();
+	}
+
+	for (ABIMPointCloudActor* Actor : PointActors)
+	{
+		Actor->Destroy();
+	}
+
+	for (const TWeakObjectPtr<AActor>& Actor : RetiredActors)
+	{
+		if (Actor.IsValid())
+		{
+			Actor->Destroy();
+		}
 	}
+	RetiredActors.Empty();
 	
 	UObject::BeginDestroy();
 }
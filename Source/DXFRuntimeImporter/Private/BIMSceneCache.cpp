@@ -0,0 +1,310 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMSceneCache.h"
+
+#include "DXFRuntimeImporter.h"
+#include "BIMImporterStats.h"
+#include "BIMMappedFile.h"
+#include "BIMImporterConfig.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/BufferReader.h"
+
+// bump when the layout or the geometry of cached buffers changes, older entries are then ignored
+#define CACHE_MAGIC 0x434D4942
+#define CACHE_VERSION 10
+
+namespace
+{
+	// Streams are copied as raw memory: cache entries never leave the machine that wrote them
+	template <typename T>
+	void SerializeStream(FArchive& Ar, TArray<T>& Stream)
+	{
+		int32 Num = Stream.Num();
+		Ar << Num;
+		if (Ar.IsLoading())
+		{
+			if (Num < 0 || Num * (int64)sizeof(T) > Ar.TotalSize() - Ar.Tell())
+			{
+				Ar.SetError();
+				return;
+			}
+			Stream.SetNumUninitialized(Num);
+		}
+		Ar.Serialize(Stream.GetData(), Num * sizeof(T));
+	}
+
+	void SerializeRenderBuffers(FArchive& Ar, FBIMRenderBuffers& Buffers)
+	{
+		int32 NumLODs = Buffers.LODs.Num();
+		Ar << NumLODs;
+		if (Ar.IsLoading())
+		{
+			Buffers.LODs.SetNum(FMath::Max(NumLODs, 0));
+		}
+
+		for (FBIMMeshLOD& LOD : Buffers.LODs)
+		{
+			Ar << LOD.ScreenSize;
+			SerializeStream(Ar, LOD.ElementVertices);
+
+			int32 NumSections = LOD.Sections.Num();
+			Ar << NumSections;
+			if (Ar.IsError()) return;
+			if (Ar.IsLoading())
+			{
+				LOD.Sections.SetNum(FMath::Max(NumSections, 0));
+			}
+
+			for (FBIMMeshSection& Section : LOD.Sections)
+			{
+				SerializeStream(Ar, Section.Positions);
+				SerializeStream(Ar, Section.Normals);
+				SerializeStream(Ar, Section.Tangents);
+				SerializeStream(Ar, Section.TexCoords);
+				SerializeStream(Ar, Section.Colors);
+				SerializeStream(Ar, Section.Triangles);
+				if (Ar.IsError()) return;
+			}
+		}
+
+		SerializeStream(Ar, Buffers.Elements);
+		Ar << Buffers.Origin.X << Buffers.Origin.Y << Buffers.Origin.Z;
+		Ar << Buffers.MaterialIndex;
+		Ar.Serialize(&Buffers.Bounds, sizeof(FBox));
+	}
+
+	template <typename BuffersType>
+	void SerializeBufferArray(FArchive& Ar, TArray<BuffersType>& Array)
+	{
+		int32 Num = Array.Num();
+		Ar << Num;
+		if (Ar.IsLoading())
+		{
+			Array.SetNum(FMath::Max(Num, 0));
+		}
+
+		for (BuffersType& Buffers : Array)
+		{
+			FBIMSceneCache::SerializeBuffers(Ar, Buffers);
+			if (Ar.IsError()) return;
+		}
+	}
+}
+
+FString FBIMSceneCache::MakeKey(const FString& Source, const FString& Version, const FBIMImportSettings& Settings)
+{
+	// only settings changing the built buffers are part of the key, with the format so entries of older builds are never looked up
+	FString Key = FString::Printf(TEXT("%d|%s|%s|%d|%d|%d|%d|%d|%d|%f|%d"),
+		CACHE_VERSION, *Source, *Version,
+		static_cast<int32>(Settings.ImportProfile),
+		static_cast<int32>(Settings.LineRenderMode),
+		static_cast<int32>(Settings.VertexColorMode),
+		Settings.bWeldVertices ? 1 : 0,
+		Settings.bMergeMeshes ? 1 : 0,
+		Settings.bQuantizePoints ? 1 : 0,
+		Settings.ClusterCellSize,
+		Settings.ClusterVertexBudget);
+	for (const float ScreenSize : Settings.LineLODScreenSizes)
+	{
+		Key += FString::Printf(TEXT("|L%f"), ScreenSize);
+	}
+	for (const FBIMMeshLODSettings& LOD : Settings.MeshLODs)
+	{
+		Key += FString::Printf(TEXT("|M%f:%f"), LOD.ScreenSize, LOD.TrianglePercent);
+	}
+	if (Settings.VertexColorMode == EBIMVertexColorMode::LayerPalette)
+	{
+		TArray<FString> Layers;
+		Settings.LayerColors.GetKeys(Layers);
+		Layers.Sort();
+		for (const FString& Layer : Layers)
+		{
+			Key += FString::Printf(TEXT("|C%s:%s"), *Layer, *Settings.LayerColors[Layer].ToFColor(true).ToHex());
+		}
+	}
+
+	return FMD5::HashAnsiString(*Key);
+}
+
+FString FBIMSceneCache::GetFileVersion(const FString& FilePath)
+{
+	const FFileStatData Stat = IFileManager::Get().GetStatData(*FilePath);
+	if (!Stat.bIsValid) return FString();
+
+	return FString::Printf(TEXT("%lld-%lld"), Stat.FileSize, Stat.ModificationTime.GetTicks());
+}
+
+FString FBIMSceneCache::GetContentVersion(const uint8* Data, int64 Size)
+{
+	FSHAHash Hash;
+	FSHA1::HashBuffer(Data, Size, Hash.Hash);
+	return Hash.ToString();
+}
+
+bool FBIMSceneCache::Contains(const FString& Key)
+{
+	return IFileManager::Get().FileExists(*GetCachePath(Key));
+}
+
+bool FBIMSceneCache::Load(const FString& Key, FBIMImportResult& OutResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMCacheLoad);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_CacheLoad);
+
+	FBIMMappedFile File;
+	const FString CachePath = GetCachePath(Key);
+	if (!IFileManager::Get().FileExists(*CachePath) || !File.Open(CachePath))
+	{
+		return false;
+	}
+
+	FBufferReader Reader(const_cast<uint8*>(File.GetData()), File.GetSize(), false);
+	Serialize(Reader, OutResult);
+	if (Reader.IsError())
+	{
+		// deleted, so the next import writes it again
+		UE_LOG(LogAssimp, Warning, TEXT("Deleting invalid cache entry %s"), *CachePath)
+		File.Close();
+		IFileManager::Get().Delete(*CachePath);
+		OutResult.MeshNames.Empty();
+		OutResult.LineNames.Empty();
+		OutResult.PointNames.Empty();
+		OutResult.MeshBuffers.Empty();
+		OutResult.LineBuffers.Empty();
+		OutResult.PointBuffers.Empty();
+		OutResult.Categories = FBIMCategories();
+		return false;
+	}
+
+	UE_LOG(LogAssimp, Log, TEXT("Loaded %d meshes, %d lines and %d point cells from cache"), OutResult.MeshBuffers.Num(), OutResult.LineBuffers.Num(), OutResult.PointBuffers.Num())
+
+	// the modification time is the last use, for Trim
+	IFileManager::Get().SetTimeStamp(*CachePath, FDateTime::UtcNow());
+	return true;
+}
+
+void FBIMSceneCache::Save(const FString& Key, FBIMImportResult& Result)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMCacheSave);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_CacheSave);
+
+	// written next to the entry and moved in place, so readers never see a partial file
+	const FString CachePath = GetCachePath(Key);
+	const FString TempPath = CachePath + TEXT(".tmp");
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+	if (!Writer)
+	{
+		UE_LOG(LogAssimp, Warning, TEXT("Could not write cache entry %s"), *TempPath)
+		return;
+	}
+
+	Serialize(*Writer, Result);
+	const bool bWritten = Writer->Close();
+	Writer.Reset();
+
+	if (!bWritten || !IFileManager::Get().Move(*CachePath, *TempPath))
+	{
+		IFileManager::Get().Delete(*TempPath);
+		return;
+	}
+
+	const int32 SizeLimitMB = GetDefault<UBIMImporterConfig>()->CacheSizeLimitMB;
+	if (SizeLimitMB > 0)
+	{
+		Trim(static_cast<int64>(SizeLimitMB) * 1024 * 1024);
+	}
+}
+
+void FBIMSceneCache::Trim(int64 MaxBytes)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_CacheTrim);
+
+	// (last use, size, path) of every entry
+	TArray<TTuple<FDateTime, int64, FString>> Entries;
+	int64 TotalBytes = 0;
+	FPlatformFileManager::Get().GetPlatformFile().IterateDirectoryStat(*GetCacheDir(), [&](const TCHAR* Path, const FFileStatData& Stat)
+	{
+		if (!Stat.bIsDirectory && FPaths::GetExtension(Path, true) == TEXT(".bimcache"))
+		{
+			Entries.Emplace(Stat.ModificationTime, Stat.FileSize, Path);
+			TotalBytes += Stat.FileSize;
+		}
+		return true;
+	});
+	if (TotalBytes <= MaxBytes) return;
+
+	// least recently used first. The newest entry stays, even alone over the limit: it was just written to be used
+	Entries.Sort([](const TTuple<FDateTime, int64, FString>& A, const TTuple<FDateTime, int64, FString>& B) { return A.Get<0>() < B.Get<0>(); });
+	for (int32 i = 0; i < Entries.Num() - 1 && TotalBytes > MaxBytes; i++)
+	{
+		// entries being read by another import can't be deleted on some platforms, they are tried again next time
+		if (IFileManager::Get().Delete(*Entries[i].Get<2>(), false, false, true))
+		{
+			TotalBytes -= Entries[i].Get<1>();
+		}
+	}
+	UE_LOG(LogAssimp, Log, TEXT("Trimmed the BIM cache to %.1f MB"), TotalBytes / (1024.0 * 1024.0))
+}
+
+FString FBIMSceneCache::GetCacheDir()
+{
+	return FPaths::ProjectSavedDir() / TEXT("BIMImporter") / TEXT("Cache");
+}
+
+FString FBIMSceneCache::GetCachePath(const FString& Key)
+{
+	return GetCacheDir() / Key + TEXT(".bimcache");
+}
+
+void FBIMSceneCache::Serialize(FArchive& Ar, FBIMImportResult& Result)
+{
+	// header: format and sizes of the raw streams
+	uint32 Magic = CACHE_MAGIC;
+	int32 Version = CACHE_VERSION;
+	int32 VertexSize = sizeof(FVector) + 2 * sizeof(FPackedNormal) + sizeof(FVector2DHalf);
+	Ar << Magic << Version << VertexSize;
+	if (Magic != CACHE_MAGIC || Version != CACHE_VERSION || VertexSize != sizeof(FVector) + 2 * sizeof(FPackedNormal) + sizeof(FVector2DHalf))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << Result.MeshNames << Result.LineNames << Result.PointNames;
+	Ar << Result.Categories.Names << Result.Categories.Sets;
+	Ar << Result.Categories.MeshSets << Result.Categories.LineSets << Result.Categories.PointSets;
+	if (Ar.IsError()) return;
+
+	SerializeBufferArray(Ar, Result.MeshBuffers);
+	if (Ar.IsError()) return;
+	SerializeBufferArray(Ar, Result.LineBuffers);
+	if (Ar.IsError()) return;
+	SerializeBufferArray(Ar, Result.PointBuffers);
+}
+
+void FBIMSceneCache::SerializeBuffers(FArchive& Ar, FBIMMeshBuffers& Buffers)
+{
+	SerializeRenderBuffers(Ar, Buffers);
+	if (Ar.IsError()) return;
+	Ar << Buffers.TrianglesSkipped;
+}
+
+void FBIMSceneCache::SerializeBuffers(FArchive& Ar, FBIMLineBuffers& Buffers)
+{
+	SerializeRenderBuffers(Ar, Buffers);
+	if (Ar.IsError()) return;
+	SerializeStream(Ar, Buffers.InstanceTransforms);
+	SerializeStream(Ar, Buffers.SegmentPoints);
+}
+
+void FBIMSceneCache::SerializeBuffers(FArchive& Ar, FBIMPointBuffers& Buffers)
+{
+	SerializeRenderBuffers(Ar, Buffers);
+	if (Ar.IsError()) return;
+	SerializeStream(Ar, Buffers.Points);
+	SerializeStream(Ar, Buffers.QuantizedPoints);
+}
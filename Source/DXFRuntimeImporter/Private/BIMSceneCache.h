@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMMeshData.h"
+#include "BIMImportSettings.h"
+
+/**
+ * On-disk cache of converted render buffers, so a model seen before skips downloading (when its version is
+ * known up front) and assimp entirely. Entries are addressed by a hash of the source, its version (ETag,
+ * file stamp or content hash) and the settings that shape the buffers. Entries are a small header followed
+ * by raw vertex streams, read back through a memory mapping. The least recently used entries are deleted once
+ * the cache outgrows its size limit. Thread-safe
+ */
+class FBIMSceneCache
+{
+public:
+	/**
+	 * Cache key of a model. Version identifies the content of Source (ETag, modification stamp or content hash)
+	 */
+	static FString MakeKey(const FString& Source, const FString& Version, const FBIMImportSettings& Settings);
+
+	// Version of a local file, from its size and modification time (empty if it doesn't exist)
+	static FString GetFileVersion(const FString& FilePath);
+
+	// Version from the content itself, for downloads the server gave no ETag for
+	static FString GetContentVersion(const uint8* Data, int64 Size);
+
+	static bool Contains(const FString& Key);
+
+	/**
+	 * Load names and buffers of a cached model into OutResult. Returns false on a miss or a stale/corrupt entry
+	 */
+	static bool Load(const FString& Key, FBIMImportResult& OutResult);
+
+	/**
+	 * Store names and buffers of a freshly built model (before they are consumed by spawning)
+	 */
+	static void Save(const FString& Key, FBIMImportResult& Result);
+
+	/**
+	 * Delete the least recently used entries until the cache holds at most MaxBytes. Save calls it with
+	 * UBIMImporterConfig::CacheSizeLimitMB
+	 */
+	static void Trim(int64 MaxBytes);
+
+	/**
+	 * Read or write the buffers of one actor as raw streams, as cache entries store them
+	 */
+	static void SerializeBuffers(FArchive& Ar, FBIMMeshBuffers& Buffers);
+	static void SerializeBuffers(FArchive& Ar, FBIMLineBuffers& Buffers);
+	static void SerializeBuffers(FArchive& Ar, FBIMPointBuffers& Buffers);
+
+private:
+	static FString GetCacheDir();
+	static FString GetCachePath(const FString& Key);
+
+	// Read or write every cached field of Result, depending on the archive direction
+	static void Serialize(FArchive& Ar, FBIMImportResult& Result);
+};
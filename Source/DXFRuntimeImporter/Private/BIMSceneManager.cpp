@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMSceneManager.h"
+
+#include "DXFRuntimeImporter.h"
+#include "Async/Async.h"
+#include "BIMImporterConfig.h"
+#include "BIMScene.h"
+#include "Engine/GameInstance.h"
+#include "Misc/QueuedThreadPool.h"
+
+// parsers recurse into nested blocks, keep a generous stack
+#define PARSE_THREAD_STACK_SIZE (1024 * 1024)
+
+void UBIMSceneManager::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const UBIMImporterConfig* Config = GetDefault<UBIMImporterConfig>();
+	MaxConcurrentImports = Config->MaxConcurrentImports;
+	MemoryBudgetMB = Config->MemoryBudgetMB;
+
+	ThreadPool = FQueuedThreadPool::Allocate();
+	if (!ThreadPool->Create(FMath::Max(Config->MaxConcurrentParses, 1), PARSE_THREAD_STACK_SIZE, TPri_SlightlyBelowNormal, TEXT("BIMImportPool")))
+	{
+		UE_LOG(LogAssimp, Warning, TEXT("Could not create the import thread pool, files are parsed on the global pool"))
+		delete ThreadPool;
+		ThreadPool = nullptr;
+	}
+}
+
+void UBIMSceneManager::Deinitialize()
+{
+	// scenes still importing fall back to the global pool for whatever is left to queue
+	for (const TPair<UBIMScene*, TPair<int32, int32>>& Job : ActiveJobs)
+	{
+		Job.Key->SetThreadPool(nullptr);
+		Job.Key->OnSceneReady.RemoveDynamic(this, &UBIMSceneManager::OnJobReady);
+		Job.Key->OnSceneFailed.RemoveDynamic(this, &UBIMSceneManager::OnJobFailed);
+	}
+	ActiveJobs.Empty();
+	PendingJobs.Empty();
+	Batches.Empty();
+
+	// parses still queued are abandoned to the global pool, finish there and unroot their scenes
+	if (ThreadPool)
+	{
+		ThreadPool->Destroy();
+		delete ThreadPool;
+		ThreadPool = nullptr;
+	}
+
+	Super::Deinitialize();
+}
+
+int32 UBIMSceneManager::ImportBatch(const TArray<FString>& Urls, float RefEasting, float RefNorthing, float RefAltitude, UMaterialInstance* MeshMaterial, UMaterialInstance* LineMaterial, const FBIMImportSettings& Settings)
+{
+	const int32 BatchId = NextBatchId++;
+	FBIMSceneBatch& Batch = Batches.Add(BatchId);
+	Batch.Urls = Urls;
+	Batch.Scenes.SetNumZeroed(Urls.Num());
+	Batch.MeshMaterial = MeshMaterial;
+	Batch.LineMaterial = LineMaterial;
+	Batch.Settings = Settings;
+	Batch.RefEasting = RefEasting;
+	Batch.RefNorthing = RefNorthing;
+	Batch.RefAltitude = RefAltitude;
+
+	// an empty batch completes on the next tick, like any other, so callers can bind OnBatchComplete first
+	if (Urls.Num() == 0)
+	{
+		TWeakObjectPtr<UBIMSceneManager> WeakThis(this);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, BatchId]()
+		{
+			if (UBIMSceneManager* This = WeakThis.Get())
+			{
+				This->CompleteBatch(BatchId);
+			}
+		});
+		return BatchId;
+	}
+
+	for (int32 i = 0; i < Urls.Num(); i++)
+	{
+		PendingJobs.Emplace(BatchId, i);
+	}
+	StartJobs();
+	return BatchId;
+}
+
+FBIMSceneMemory UBIMSceneManager::GetMemoryUsage() const
+{
+	FBIMSceneMemory Memory;
+	for (const TWeakObjectPtr<UBIMScene>& WeakScene : ManagedScenes)
+	{
+		if (const UBIMScene* Scene = WeakScene.Get())
+		{
+			const FBIMSceneMemory SceneMemory = Scene->GetMemoryUsage();
+			Memory.SourceBytes += SceneMemory.SourceBytes;
+			Memory.MeshDataBytes += SceneMemory.MeshDataBytes;
+			Memory.RenderBytes += SceneMemory.RenderBytes;
+			Memory.TotalBytes += SceneMemory.TotalBytes;
+		}
+	}
+	return Memory;
+}
+
+void UBIMSceneManager::StartJobs()
+{
+	while (PendingJobs.Num() > 0 && ActiveJobs.Num() < FMath::Max(MaxConcurrentImports, 1))
+	{
+		if (IsOverBudget())
+		{
+			// ready scenes in flight give up their source data on the next check, which may make room again
+			if (ActiveJobs.Num() > 0) return;
+
+			// nothing left that could free memory, the remaining files can't be imported
+			UE_LOG(LogAssimp, Warning, TEXT("Memory budget of %d MB exceeded, %d queued files are skipped"), MemoryBudgetMB, PendingJobs.Num())
+			const TArray<TPair<int32, int32>> Skipped = MoveTemp(PendingJobs);
+			for (const TPair<int32, int32>& Job : Skipped)
+			{
+				FBIMSceneBatch& Batch = Batches[Job.Key];
+				Batch.FailedUrls.Add(Batch.Urls[Job.Value]);
+				Batch.Completed++;
+				OnBatchProgress.Broadcast(Job.Key, Batch.Completed, Batch.Urls.Num());
+				if (Batch.Completed == Batch.Urls.Num())
+				{
+					CompleteBatch(Job.Key);
+				}
+			}
+			return;
+		}
+
+		const TPair<int32, int32> Job = PendingJobs[0];
+		PendingJobs.RemoveAt(0, 1, false);
+
+		const FBIMSceneBatch& Batch = Batches[Job.Key];
+		UObject* Outer = GetGameInstance();
+		UBIMScene* Scene = UBIMScene::ImportScene(Batch.Urls[Job.Value], Batch.RefEasting, Batch.RefNorthing, Batch.RefAltitude, Batch.MeshMaterial, Batch.LineMaterial, Outer, Batch.Settings);
+		Scene->SetThreadPool(ThreadPool);
+		Scene->OnSceneReady.AddDynamic(this, &UBIMSceneManager::OnJobReady);
+		Scene->OnSceneFailed.AddDynamic(this, &UBIMSceneManager::OnJobFailed);
+
+		ActiveJobs.Add(Scene, Job);
+		ManagedScenes.Add(Scene);
+	}
+}
+
+bool UBIMSceneManager::IsOverBudget()
+{
+	if (MemoryBudgetMB <= 0) return false;
+
+	const int64 Budget = static_cast<int64>(MemoryBudgetMB) * 1024 * 1024;
+	ManagedScenes.RemoveAll([](const TWeakObjectPtr<UBIMScene>& Scene) { return !Scene.IsValid(); });
+	if (GetMemoryUsage().TotalBytes <= Budget) return false;
+
+	// ready scenes don't need their source data to render
+	for (const TWeakObjectPtr<UBIMScene>& WeakScene : ManagedScenes)
+	{
+		UBIMScene* Scene = WeakScene.Get();
+		if (Scene && !ActiveJobs.Contains(Scene))
+		{
+			Scene->ReleaseSourceData();
+		}
+	}
+	return GetMemoryUsage().TotalBytes > Budget;
+}
+
+void UBIMSceneManager::OnJobReady(UBIMScene* Scene)
+{
+	FinishJob(Scene, true);
+}
+
+void UBIMSceneManager::OnJobFailed(UBIMScene* Scene, const FString& Error)
+{
+	UE_LOG(LogAssimp, Warning, TEXT("Batch file %s failed: %s"), *Scene->BIMUrl, *Error)
+	FinishJob(Scene, false);
+}
+
+void UBIMSceneManager::FinishJob(UBIMScene* Scene, bool bSucceeded)
+{
+	TPair<int32, int32> Job;
+	if (!ActiveJobs.RemoveAndCopyValue(Scene, Job)) return;
+
+	Scene->OnSceneReady.RemoveDynamic(this, &UBIMSceneManager::OnJobReady);
+	Scene->OnSceneFailed.RemoveDynamic(this, &UBIMSceneManager::OnJobFailed);
+
+	// the batch keeps the scene referenced until it is handed over with OnBatchComplete
+	FBIMSceneBatch& Batch = Batches[Job.Key];
+	if (bSucceeded)
+	{
+		Batch.Scenes[Job.Value] = Scene;
+	}
+	else
+	{
+		Batch.FailedUrls.Add(Batch.Urls[Job.Value]);
+	}
+	Batch.Completed++;
+	OnBatchProgress.Broadcast(Job.Key, Batch.Completed, Batch.Urls.Num());
+
+	if (Batch.Completed == Batch.Urls.Num())
+	{
+		CompleteBatch(Job.Key);
+	}
+	StartJobs();
+}
+
+void UBIMSceneManager::CompleteBatch(int32 BatchId)
+{
+	FBIMSceneBatch Batch;
+	if (!Batches.RemoveAndCopyValue(BatchId, Batch)) return;
+
+	// scenes of failed files are left out
+	TArray<UBIMScene*> Scenes;
+	for (UBIMScene* Scene : Batch.Scenes)
+	{
+		if (Scene)
+		{
+			Scenes.Add(Scene);
+		}
+	}
+
+	UE_LOG(LogAssimp, Log, TEXT("Batch %d complete: %d of %d files imported"), BatchId, Scenes.Num(), Batch.Urls.Num())
+	OnBatchComplete.Broadcast(BatchId, Scenes, Batch.FailedUrls);
+}
@@ -0,0 +1,518 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMSpatialIndex.h"
+
+#include "Async/ParallelFor.h"
+#include "BIMImporterStats.h"
+
+// primitives per leaf below which nodes are never split, and above which they always are
+#define LEAF_SIZE 4
+#define MAX_LEAF_SIZE 16
+
+// centroid bins evaluated per axis when looking for the best split
+#define SAH_BINS 16
+
+namespace
+{
+	FORCEINLINE float HalfArea(const FBox& Box)
+	{
+		const FVector D = Box.Max - Box.Min;
+		return D.X * D.Y + D.Y * D.Z + D.Z * D.X;
+	}
+
+	FORCEINLINE int32 GetBin(const float Center, const float Min, const float Scale)
+	{
+		return FMath::Clamp(static_cast<int32>((Center - Min) * Scale), 0, SAH_BINS - 1);
+	}
+
+	// Slab test, OutT is where the ray enters the box
+	template <typename NodeType>
+	FORCEINLINE bool RayBox(const NodeType& Node, const FVector& Start, const FVector& InvDir, const float MaxT, float& OutT)
+	{
+		const FVector T0 = (Node.Min - Start) * InvDir;
+		const FVector T1 = (Node.Max - Start) * InvDir;
+		const float TNear = FMath::Max3(FMath::Min(T0.X, T1.X), FMath::Min(T0.Y, T1.Y), FMath::Min(T0.Z, T1.Z));
+		const float TFar = FMath::Min3(FMath::Max(T0.X, T1.X), FMath::Max(T0.Y, T1.Y), FMath::Max(T0.Z, T1.Z));
+		OutT = TNear;
+		return TNear <= TFar && TFar >= 0.0f && TNear <= MaxT;
+	}
+
+	template <typename NodeType>
+	FORCEINLINE float BoxDistSquared(const NodeType& Node, const FVector& P)
+	{
+		return FBox(Node.Min, Node.Max).ComputeSquaredDistanceToPoint(P);
+	}
+}
+
+void FBIMSpatialIndex::Build(const TArray<FBIMMeshBuffers>& MeshBuffers, const TArray<FBIMLineBuffers>& LineBuffers, float LineRadius)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BIMSpatialIndex);
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_BuildSpatialIndex);
+
+	Nodes.Reset();
+	Vertices.Reset();
+	Indices.Reset();
+	PrimitiveElements.Reset();
+	Radius = LineRadius;
+	Origin = LineBuffers.Num() > 0 ? LineBuffers[0].Origin : (MeshBuffers.Num() > 0 ? MeshBuffers[0].Origin : FBIMOrigin());
+
+	// Gather primitives, numbering elements in spawn order (lines, then meshes)
+	int32 ElementId = 0;
+	for (const FBIMLineBuffers& Buffers : LineBuffers)
+	{
+		const FVector Offset = Buffers.Origin - Origin;
+		const int32 BaseVertex = Vertices.Num();
+		for (const FVector& Point : Buffers.SegmentPoints)
+		{
+			Vertices.Add(Point + Offset);
+		}
+
+		for (const FBIMElementRange& Range : Buffers.Elements)
+		{
+			for (int32 s = Range.FirstSegment; s < Range.FirstSegment + Range.NumSegments; s++)
+			{
+				Indices.Add(BaseVertex + 2 * s);
+				Indices.Add(BaseVertex + 2 * s + 1);
+				Indices.Add(INDEX_NONE);
+				PrimitiveElements.Add(ElementId);
+			}
+			ElementId++;
+		}
+	}
+
+	for (const FBIMMeshBuffers& Buffers : MeshBuffers)
+	{
+		const FVector Offset = Buffers.Origin - Origin;
+		TArray<int32> BaseVertices;
+		if (Buffers.LODs.Num() > 0)
+		{
+			for (const FBIMMeshSection& Section : Buffers.LODs[0].Sections)
+			{
+				BaseVertices.Add(Vertices.Num());
+				for (const FVector& Position : Section.Positions)
+				{
+					Vertices.Add(Position + Offset);
+				}
+			}
+		}
+
+		for (const FBIMElementRange& Range : Buffers.Elements)
+		{
+			if (BaseVertices.IsValidIndex(Range.SectionIndex))
+			{
+				const TArray<int32>& Triangles = Buffers.LODs[0].Sections[Range.SectionIndex].Triangles;
+				const int32 End = FMath::Min(Range.FirstIndex + Range.NumIndices, Triangles.Num());
+				for (int32 i = Range.FirstIndex; i + 2 < End; i += 3)
+				{
+					Indices.Add(BaseVertices[Range.SectionIndex] + Triangles[i]);
+					Indices.Add(BaseVertices[Range.SectionIndex] + Triangles[i + 1]);
+					Indices.Add(BaseVertices[Range.SectionIndex] + Triangles[i + 2]);
+					PrimitiveElements.Add(ElementId);
+				}
+			}
+			ElementId++;
+		}
+	}
+
+	const int32 NumPrimitives = PrimitiveElements.Num();
+	if (NumPrimitives == 0) return;
+
+	TArray<FBox> Bounds;
+	TArray<FVector> Centers;
+	Bounds.SetNumUninitialized(NumPrimitives);
+	Centers.SetNumUninitialized(NumPrimitives);
+	ParallelFor(NumPrimitives, [&](int32 p)
+	{
+		Bounds[p] = GetPrimitiveBounds(p);
+		Centers[p] = Bounds[p].GetCenter();
+	});
+
+	TArray<int32> Order;
+	Order.SetNumUninitialized(NumPrimitives);
+	for (int32 p = 0; p < NumPrimitives; p++)
+	{
+		Order[p] = p;
+	}
+
+	// Top-down build, splitting at the cheapest centroid bin boundary by surface area heuristic
+	struct FTask
+	{
+		int32 Node;
+		int32 Start;
+		int32 Count;
+	};
+	TArray<FTask> Tasks;
+	Nodes.Reserve(2 * NumPrimitives / LEAF_SIZE + 1);
+	Nodes.AddUninitialized(1);
+	Tasks.Push(FTask{ 0, 0, NumPrimitives });
+
+	while (Tasks.Num() > 0)
+	{
+		const FTask Task = Tasks.Pop(false);
+		const int32 End = Task.Start + Task.Count;
+
+		FBox NodeBox(ForceInit);
+		FBox CenterBox(ForceInit);
+		for (int32 i = Task.Start; i < End; i++)
+		{
+			NodeBox += Bounds[Order[i]];
+			CenterBox += Centers[Order[i]];
+		}
+		Nodes[Task.Node].Min = NodeBox.Min;
+		Nodes[Task.Node].Max = NodeBox.Max;
+		Nodes[Task.Node].Start = Task.Start;
+		Nodes[Task.Node].Count = Task.Count;
+
+		if (Task.Count <= LEAF_SIZE) continue;
+
+		float BestCost = MAX_flt;
+		int32 BestAxis = INDEX_NONE;
+		int32 BestBin = 0;
+		const FVector Extent = CenterBox.Max - CenterBox.Min;
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (Extent[Axis] <= KINDA_SMALL_NUMBER) continue;
+
+			FBox BinBounds[SAH_BINS];
+			int32 BinCounts[SAH_BINS];
+			for (int32 b = 0; b < SAH_BINS; b++)
+			{
+				BinBounds[b] = FBox(ForceInit);
+				BinCounts[b] = 0;
+			}
+
+			const float Scale = SAH_BINS / Extent[Axis];
+			for (int32 i = Task.Start; i < End; i++)
+			{
+				const int32 Bin = GetBin(Centers[Order[i]][Axis], CenterBox.Min[Axis], Scale);
+				BinBounds[Bin] += Bounds[Order[i]];
+				BinCounts[Bin]++;
+			}
+
+			// cost of splitting before bin b: left side from a forward sweep, right side from a backward one
+			float LeftCost[SAH_BINS];
+			FBox Accumulated(ForceInit);
+			int32 Count = 0;
+			for (int32 b = 0; b < SAH_BINS - 1; b++)
+			{
+				Accumulated += BinBounds[b];
+				Count += BinCounts[b];
+				LeftCost[b + 1] = Count > 0 ? Count * HalfArea(Accumulated) : -1.0f;
+			}
+
+			Accumulated = FBox(ForceInit);
+			Count = 0;
+			for (int32 b = SAH_BINS - 1; b > 0; b--)
+			{
+				Accumulated += BinBounds[b];
+				Count += BinCounts[b];
+				if (Count == 0 || LeftCost[b] < 0.0f) continue;
+
+				const float Cost = LeftCost[b] + Count * HalfArea(Accumulated);
+				if (Cost < BestCost)
+				{
+					BestCost = Cost;
+					BestAxis = Axis;
+					BestBin = b;
+				}
+			}
+		}
+
+		// small nodes stay leaves when splitting doesn't pay for the extra traversal step
+		if (Task.Count <= MAX_LEAF_SIZE && (BestAxis == INDEX_NONE || BestCost + HalfArea(NodeBox) >= Task.Count * HalfArea(NodeBox)))
+		{
+			continue;
+		}
+
+		int32 Mid = Task.Start + Task.Count / 2;
+		if (BestAxis != INDEX_NONE)
+		{
+			const float Scale = SAH_BINS / Extent[BestAxis];
+			int32 i = Task.Start;
+			int32 j = End - 1;
+			while (i <= j)
+			{
+				if (GetBin(Centers[Order[i]][BestAxis], CenterBox.Min[BestAxis], Scale) < BestBin)
+				{
+					i++;
+				}
+				else
+				{
+					Swap(Order[i], Order[j--]);
+				}
+			}
+			if (i > Task.Start && i < End)
+			{
+				Mid = i;
+			}
+		}
+
+		const int32 Left = Nodes.AddUninitialized(2);
+		Nodes[Task.Node].Start = Left;
+		Nodes[Task.Node].Count = 0;
+		Tasks.Push(FTask{ Left, Task.Start, Mid - Task.Start });
+		Tasks.Push(FTask{ Left + 1, Mid, End - Mid });
+	}
+
+	// Store primitives in leaf order
+	TArray<int32> SortedIndices;
+	TArray<int32> SortedElements;
+	SortedIndices.SetNumUninitialized(NumPrimitives * 3);
+	SortedElements.SetNumUninitialized(NumPrimitives);
+	for (int32 p = 0; p < NumPrimitives; p++)
+	{
+		SortedIndices[3 * p] = Indices[3 * Order[p]];
+		SortedIndices[3 * p + 1] = Indices[3 * Order[p] + 1];
+		SortedIndices[3 * p + 2] = Indices[3 * Order[p] + 2];
+		SortedElements[p] = PrimitiveElements[Order[p]];
+	}
+	Indices = MoveTemp(SortedIndices);
+	PrimitiveElements = MoveTemp(SortedElements);
+	Nodes.Shrink();
+}
+
+bool FBIMSpatialIndex::Raycast(const FVector& Start, const FVector& End, FHit& OutHit) const
+{
+	FVector Dir = End - Start;
+	const float Length = Dir.Size();
+	if (Nodes.Num() == 0 || Length < KINDA_SMALL_NUMBER) return false;
+	Dir /= Length;
+
+	const FVector InvDir(
+		FMath::Abs(Dir.X) > SMALL_NUMBER ? 1.0f / Dir.X : BIG_NUMBER,
+		FMath::Abs(Dir.Y) > SMALL_NUMBER ? 1.0f / Dir.Y : BIG_NUMBER,
+		FMath::Abs(Dir.Z) > SMALL_NUMBER ? 1.0f / Dir.Z : BIG_NUMBER
+	);
+
+	float BestT = Length;
+	int32 BestPrimitive = INDEX_NONE;
+	FVector BestNormal = FVector::ZeroVector;
+
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Push(0);
+	while (Stack.Num() > 0)
+	{
+		const FNode& Node = Nodes[Stack.Pop(false)];
+		float TNode;
+		if (!RayBox(Node, Start, InvDir, BestT, TNode)) continue;
+
+		if (Node.Count > 0)
+		{
+			for (int32 p = Node.Start; p < Node.Start + Node.Count; p++)
+			{
+				FVector Normal;
+				const float T = IntersectPrimitive(p, Start, Dir, BestT, Normal);
+				if (T >= 0.0f)
+				{
+					BestT = T;
+					BestPrimitive = p;
+					BestNormal = Normal;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first (pushed last)
+		float TLeft, TRight;
+		const bool bLeft = RayBox(Nodes[Node.Start], Start, InvDir, BestT, TLeft);
+		const bool bRight = RayBox(Nodes[Node.Start + 1], Start, InvDir, BestT, TRight);
+		if (bLeft && bRight)
+		{
+			Stack.Push(TLeft < TRight ? Node.Start + 1 : Node.Start);
+			Stack.Push(TLeft < TRight ? Node.Start : Node.Start + 1);
+		}
+		else if (bLeft)
+		{
+			Stack.Push(Node.Start);
+		}
+		else if (bRight)
+		{
+			Stack.Push(Node.Start + 1);
+		}
+	}
+
+	if (BestPrimitive == INDEX_NONE) return false;
+
+	OutHit.Element = PrimitiveElements[BestPrimitive];
+	OutHit.Location = Start + Dir * BestT;
+	OutHit.Normal = BestNormal;
+	OutHit.Distance = BestT;
+	return true;
+}
+
+void FBIMSpatialIndex::QueryBox(const FBox& Box, TArray<int32>& OutElements) const
+{
+	if (Nodes.Num() == 0 || !Box.IsValid) return;
+
+	TSet<int32> Found;
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Push(0);
+	while (Stack.Num() > 0)
+	{
+		const FNode& Node = Nodes[Stack.Pop(false)];
+		if (!Box.Intersect(FBox(Node.Min, Node.Max))) continue;
+
+		if (Node.Count > 0)
+		{
+			for (int32 p = Node.Start; p < Node.Start + Node.Count; p++)
+			{
+				if (!Found.Contains(PrimitiveElements[p]) && Box.Intersect(GetPrimitiveBounds(p)))
+				{
+					Found.Add(PrimitiveElements[p]);
+				}
+			}
+		}
+		else
+		{
+			Stack.Push(Node.Start);
+			Stack.Push(Node.Start + 1);
+		}
+	}
+
+	OutElements = Found.Array();
+	OutElements.Sort();
+}
+
+bool FBIMSpatialIndex::Nearest(const FVector& Location, float MaxDistance, FHit& OutHit) const
+{
+	if (Nodes.Num() == 0) return false;
+
+	float BestDistance = MaxDistance;
+	bool bFound = false;
+
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Push(0);
+	while (Stack.Num() > 0)
+	{
+		const FNode& Node = Nodes[Stack.Pop(false)];
+		if (BoxDistSquared(Node, Location) > BestDistance * BestDistance) continue;
+
+		if (Node.Count > 0)
+		{
+			for (int32 p = Node.Start; p < Node.Start + Node.Count; p++)
+			{
+				FVector Closest, Normal;
+				const float Distance = PrimitiveDistance(p, Location, Closest, Normal);
+				if (Distance <= BestDistance)
+				{
+					BestDistance = Distance;
+					bFound = true;
+					OutHit.Element = PrimitiveElements[p];
+					OutHit.Location = Closest;
+					OutHit.Normal = Normal;
+					OutHit.Distance = Distance;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first (pushed last)
+		const float DistLeft = BoxDistSquared(Nodes[Node.Start], Location);
+		const float DistRight = BoxDistSquared(Nodes[Node.Start + 1], Location);
+		Stack.Push(DistLeft < DistRight ? Node.Start + 1 : Node.Start);
+		Stack.Push(DistLeft < DistRight ? Node.Start : Node.Start + 1);
+	}
+
+	return bFound;
+}
+
+SIZE_T FBIMSpatialIndex::GetAllocatedSize() const
+{
+	return Nodes.GetAllocatedSize() + Vertices.GetAllocatedSize() + Indices.GetAllocatedSize() + PrimitiveElements.GetAllocatedSize();
+}
+
+FBox FBIMSpatialIndex::GetPrimitiveBounds(int32 Primitive) const
+{
+	const int32* Tri = &Indices[3 * Primitive];
+	FBox Box(ForceInit);
+	Box += Vertices[Tri[0]];
+	Box += Vertices[Tri[1]];
+	if (Tri[2] == INDEX_NONE)
+	{
+		return Box.ExpandBy(Radius);
+	}
+	Box += Vertices[Tri[2]];
+	return Box;
+}
+
+float FBIMSpatialIndex::PrimitiveDistance(int32 Primitive, const FVector& P, FVector& OutClosest, FVector& OutNormal) const
+{
+	const int32* Tri = &Indices[3 * Primitive];
+	const FVector& A = Vertices[Tri[0]];
+	const FVector& B = Vertices[Tri[1]];
+
+	// capsule around the segment
+	if (Tri[2] == INDEX_NONE)
+	{
+		const FVector OnAxis = FMath::ClosestPointOnSegment(P, A, B);
+		const FVector ToP = P - OnAxis;
+		const float AxisDistance = ToP.Size();
+		OutNormal = AxisDistance > SMALL_NUMBER ? ToP / AxisDistance : FVector::UpVector;
+		OutClosest = AxisDistance > Radius ? OnAxis + OutNormal * Radius : P;
+		return FMath::Max(AxisDistance - Radius, 0.0f);
+	}
+
+	const FVector& C = Vertices[Tri[2]];
+	OutClosest = FMath::ClosestPointOnTriangleToPoint(P, A, B, C);
+	OutNormal = ((B - A) ^ (C - A)).GetSafeNormal();
+	if ((OutNormal | (P - OutClosest)) < 0.0f)
+	{
+		OutNormal = -OutNormal;
+	}
+	return (P - OutClosest).Size();
+}
+
+float FBIMSpatialIndex::IntersectPrimitive(int32 Primitive, const FVector& Start, const FVector& Dir, float MaxT, FVector& OutNormal) const
+{
+	const int32* Tri = &Indices[3 * Primitive];
+	const FVector& A = Vertices[Tri[0]];
+	const FVector& B = Vertices[Tri[1]];
+
+	// capsule: entry point from the closest approach of the ray to the segment
+	if (Tri[2] == INDEX_NONE)
+	{
+		FVector OnRay, OnAxis;
+		FMath::SegmentDistToSegmentSafe(Start, Start + Dir * MaxT, A, B, OnRay, OnAxis);
+		const float DistSquared = FVector::DistSquared(OnRay, OnAxis);
+		if (DistSquared > Radius * Radius) return -1.0f;
+
+		const float T = FMath::Max(((OnRay - Start) | Dir) - FMath::Sqrt(Radius * Radius - DistSquared), 0.0f);
+		if (T >= MaxT) return -1.0f;
+
+		const FVector Hit = Start + Dir * T;
+		OutNormal = (Hit - FMath::ClosestPointOnSegment(Hit, A, B)).GetSafeNormal();
+		if (OutNormal.IsZero())
+		{
+			OutNormal = -Dir;
+		}
+		return T;
+	}
+
+	// Moller-Trumbore, double sided
+	const FVector& C = Vertices[Tri[2]];
+	const FVector E1 = B - A;
+	const FVector E2 = C - A;
+	const FVector PVec = Dir ^ E2;
+	const float Det = E1 | PVec;
+	if (FMath::Abs(Det) < SMALL_NUMBER) return -1.0f;
+
+	const float InvDet = 1.0f / Det;
+	const FVector TVec = Start - A;
+	const float U = (TVec | PVec) * InvDet;
+	if (U < 0.0f || U > 1.0f) return -1.0f;
+
+	const FVector QVec = TVec ^ E1;
+	const float V = (Dir | QVec) * InvDet;
+	if (V < 0.0f || U + V > 1.0f) return -1.0f;
+
+	const float T = (E2 | QVec) * InvDet;
+	if (T < 0.0f || T >= MaxT) return -1.0f;
+
+	OutNormal = (E1 ^ E2).GetSafeNormal();
+	if ((OutNormal | Dir) > 0.0f)
+	{
+		OutNormal = -OutNormal;
+	}
+	return T;
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMMeshData.h"
+
+/**
+ * Bounding volume hierarchy (binned SAH) over the LOD0 triangles and line segments of a scene, for picking
+ * and spatial queries without physics. Holds its own compact copy of positions and indices, relative to a
+ * double precision origin. Built on any thread, queries are const and thread-safe
+ */
+class FBIMSpatialIndex
+{
+public:
+	struct FHit
+	{
+		// element id: line elements first, then mesh elements, in buffer order
+		int32 Element = INDEX_NONE;
+		FVector Location = FVector::ZeroVector;
+		FVector Normal = FVector::ZeroVector;
+		float Distance = 0.0f;
+	};
+
+	/**
+	 * Index every LOD0 triangle of MeshBuffers and every segment of LineBuffers (as capsules of LineRadius)
+	 */
+	void Build(const TArray<FBIMMeshBuffers>& MeshBuffers, const TArray<FBIMLineBuffers>& LineBuffers, float LineRadius);
+
+	// Positions passed to and returned by queries are relative to this origin
+	const FBIMOrigin& GetOrigin() const
+	{
+		return Origin;
+	}
+
+	/**
+	 * Closest hit along the segment from Start to End
+	 */
+	bool Raycast(const FVector& Start, const FVector& End, FHit& OutHit) const;
+
+	/**
+	 * Ids of the elements with a triangle or segment whose bounds overlap Box
+	 */
+	void QueryBox(const FBox& Box, TArray<int32>& OutElements) const;
+
+	/**
+	 * Closest surface point to Location, no further than MaxDistance
+	 */
+	bool Nearest(const FVector& Location, float MaxDistance, FHit& OutHit) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	// Count is 0 for interior nodes, whose children are Start and Start + 1. Leaves hold primitives [Start, Start + Count)
+	struct FNode
+	{
+		FVector Min;
+		int32 Start;
+		FVector Max;
+		int32 Count;
+	};
+
+	FBox GetPrimitiveBounds(int32 Primitive) const;
+
+	// Distance from P to a primitive's surface, with the closest point on it and the surface normal there
+	float PrimitiveDistance(int32 Primitive, const FVector& P, FVector& OutClosest, FVector& OutNormal) const;
+
+	// Ray parameter of the primitive hit (< MaxT), or -1
+	float IntersectPrimitive(int32 Primitive, const FVector& Start, const FVector& Dir, float MaxT, FVector& OutNormal) const;
+
+	TArray<FNode> Nodes;
+	TArray<FVector> Vertices;
+
+	// three vertices per primitive, the third is INDEX_NONE for line segments
+	TArray<int32> Indices;
+
+	// element id of each primitive
+	TArray<int32> PrimitiveElements;
+
+	FBIMOrigin Origin;
+	float Radius = 0.0f;
+};
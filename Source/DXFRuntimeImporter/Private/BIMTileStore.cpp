@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BIMTileStore.h"
+
+#include "DXFRuntimeImporter.h"
+#include "BIMSceneCache.h"
+#include "BIMImporterStats.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "HAL/FileManager.h"
+#include "Serialization/BufferReader.h"
+
+namespace
+{
+	template <typename BuffersType>
+	void WriteTile(FArchive& Writer, BuffersType& Buffers, bool bIsLine, int32& NextElement, TArray<FBIMTile>& Tiles)
+	{
+		FBIMTile& Tile = Tiles.AddDefaulted_GetRef();
+		Tile.bIsLine = bIsLine;
+		Tile.Origin = Buffers.Origin;
+		Tile.Bounds = Buffers.Bounds;
+		Tile.FirstElement = NextElement;
+		Tile.NumElements = Buffers.Elements.Num();
+		Tile.RenderBytes = GetBIMRenderSize(Buffers.LODs);
+		Tile.Offset = Writer.Tell();
+		FBIMSceneCache::SerializeBuffers(Writer, Buffers);
+		Tile.Size = Writer.Tell() - Tile.Offset;
+
+		NextElement += Buffers.Elements.Num();
+	}
+}
+
+FBIMTileStore::~FBIMTileStore()
+{
+	File.Close();
+	if (!FilePath.IsEmpty())
+	{
+		IFileManager::Get().Delete(*FilePath);
+	}
+}
+
+bool FBIMTileStore::Write(const FString& InFilePath, TArray<FBIMMeshBuffers>& MeshBuffers, TArray<FBIMLineBuffers>& LineBuffers)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_WriteTiles);
+
+	FilePath = InFilePath;
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Writer)
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Could not write tile store %s"), *FilePath)
+		return false;
+	}
+
+	// same order as the spatial index numbers elements
+	int32 NextElement = 0;
+	for (FBIMLineBuffers& Buffers : LineBuffers)
+	{
+		WriteTile(*Writer, Buffers, true, NextElement, Tiles);
+		Tiles.Last().RenderBytes += Buffers.InstanceTransforms.Num() * static_cast<int64>(sizeof(FInstancedStaticMeshInstanceData));
+	}
+	for (FBIMMeshBuffers& Buffers : MeshBuffers)
+	{
+		WriteTile(*Writer, Buffers, false, NextElement, Tiles);
+	}
+
+	if (!Writer->Close())
+	{
+		UE_LOG(LogAssimp, Error, TEXT("Could not write tile store %s"), *FilePath)
+		return false;
+	}
+	Writer.Reset();
+
+	return File.Open(FilePath);
+}
+
+bool FBIMTileStore::LoadTile(int32 TileIndex, FBIMMeshBuffers& OutBuffers) const
+{
+	return LoadTileBuffers(TileIndex, OutBuffers);
+}
+
+bool FBIMTileStore::LoadTile(int32 TileIndex, FBIMLineBuffers& OutBuffers) const
+{
+	return LoadTileBuffers(TileIndex, OutBuffers);
+}
+
+template <typename BuffersType>
+bool FBIMTileStore::LoadTileBuffers(int32 TileIndex, BuffersType& OutBuffers) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BIM_LoadTile);
+
+	if (!Tiles.IsValidIndex(TileIndex) || Tiles[TileIndex].Offset + Tiles[TileIndex].Size > File.GetSize())
+	{
+		return false;
+	}
+
+	const FBIMTile& Tile = Tiles[TileIndex];
+	FBufferReader Reader(const_cast<uint8*>(File.GetData() + Tile.Offset), Tile.Size, false);
+	FBIMSceneCache::SerializeBuffers(Reader, OutBuffers);
+	return !Reader.IsError();
+}
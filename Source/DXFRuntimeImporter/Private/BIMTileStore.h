@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMMeshData.h"
+#include "BIMMappedFile.h"
+
+/**
+ * One streamable tile: the buffers of a single actor (a spatial cluster when meshes are merged)
+ */
+struct FBIMTile
+{
+	bool bIsLine = false;
+
+	// bounds relative to Origin
+	FBIMOrigin Origin;
+	FBox Bounds = FBox(ForceInit);
+
+	// elements of the tile in the scene's element table
+	int32 FirstElement = 0;
+	int32 NumElements = 0;
+
+	// estimated render data of the tile once loaded, with the provider's CPU copy as GetBIMRenderSize counts it
+	int64 RenderBytes = 0;
+
+	// serialized buffers in the store file
+	int64 Offset = 0;
+	int64 Size = 0;
+};
+
+/**
+ * Local store of the converted buffers of a streamed scene, one tile per actor, written once to a temporary
+ * file and read back through a memory mapping whenever a tile comes into range. The file is deleted with the store.
+ * Write on any thread; loads are const and thread-safe
+ */
+class FBIMTileStore
+{
+public:
+	~FBIMTileStore();
+
+	/**
+	 * Write every buffer as a tile, lines first, with element ids numbered from 0 in the same order.
+	 * Returns false if the file could not be written or mapped
+	 */
+	bool Write(const FString& InFilePath, TArray<FBIMMeshBuffers>& MeshBuffers, TArray<FBIMLineBuffers>& LineBuffers);
+
+	const TArray<FBIMTile>& GetTiles() const
+	{
+		return Tiles;
+	}
+
+	// Read the buffers of a tile back. Returns false if the store is damaged
+	bool LoadTile(int32 TileIndex, FBIMMeshBuffers& OutBuffers) const;
+	bool LoadTile(int32 TileIndex, FBIMLineBuffers& OutBuffers) const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Tiles.GetAllocatedSize();
+	}
+
+private:
+	template <typename BuffersType>
+	bool LoadTileBuffers(int32 TileIndex, BuffersType& OutBuffers) const;
+
+	FString FilePath;
+	FBIMMappedFile File;
+	TArray<FBIMTile> Tiles;
+};
@@ -1,22 +1,51 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "DXFRuntimeImporter.h"
+#include "BIMImporterStats.h"
 #include "Core.h"
 #include "Modules/ModuleManager.h"
+#include "assimp/DefaultLogger.hpp"
 
 #define LOCTEXT_NAMESPACE "FDXFRuntimeImporterModule"
 
 DEFINE_LOG_CATEGORY(LogAssimp);
 
+DEFINE_STAT(STAT_BIMReadScene);
+DEFINE_STAT(STAT_BIMBuildBuffers);
+DEFINE_STAT(STAT_BIMSpatialIndex);
+DEFINE_STAT(STAT_BIMBuildProxies);
+DEFINE_STAT(STAT_BIMCacheLoad);
+DEFINE_STAT(STAT_BIMCacheSave);
+DEFINE_STAT(STAT_BIMCreateSections);
+DEFINE_STAT(STAT_BIMSpawn);
+DEFINE_STAT(STAT_BIMStreaming);
+DEFINE_STAT(STAT_BIMCollision);
+DEFINE_STAT(STAT_BIMSourceMemory);
+DEFINE_STAT(STAT_BIMRenderMemory);
+
+CSV_DEFINE_CATEGORY(BIMImporter, true);
+
+Assimp::Logger::LogSeverity UEAssimpStream::GetSeverity()
+{
+	// assimp drops messages below its severity before formatting them
+	if (UE_LOG_ACTIVE(LogAssimp, VeryVerbose))
+	{
+		return Assimp::Logger::VERBOSE;
+	}
+	return UE_LOG_ACTIVE(LogAssimp, Verbose) ? Assimp::Logger::DEBUGGING : Assimp::Logger::NORMAL;
+}
+
 void FDXFRuntimeImporterModule::StartupModule()
 {
-	
+	// one logger for every import, imports on worker threads log concurrently
+	Assimp::DefaultLogger::set(new UEAssimpStream());
 }
 
 void FDXFRuntimeImporterModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	Assimp::DefaultLogger::kill();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BIMBenchmarkCommandlet.generated.h"
+
+/**
+ * Headless benchmark of the import pipeline. Generates synthetic DXF models of increasing size (lines only,
+ * meshes only and mixed), imports each one stage by stage and writes the timings and memory to CSV and JSON.
+ *
+ * UE4Editor-Cmd <Project> -run=BIMBenchmark -nullrhi [-sizes=1000,10000,100000] [-kinds=lines,meshes,mixed]
+ *     [-files=a.dxf+b.glb] [-profile=Balanced] [-http[=8471]] [-nospawn] [-output=<dir>]
+ *
+ * -http serves the models from a local HTTP server so downloads are timed too
+ */
+UCLASS()
+class DXFRUNTIMEIMPORTER_API UBIMBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBIMBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMElement.generated.h"
+
+/**
+ * One BIM element (an assimp mesh of the source file) and where it is rendered.
+ * Several elements share an actor when meshes are merged into clusters
+ */
+USTRUCT(BlueprintType)
+struct DXFRUNTIMEIMPORTER_API FBIMElement
+{
+	GENERATED_BODY()
+
+	// name of the source mesh
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	FString Name;
+
+	// ABIMMeshActor, ABIMPolyLineActor or ABIMPointCloudActor rendering this element
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	AActor* Actor = nullptr;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	bool bIsLine = false;
+
+	// the points of one source mesh within one grid cell, FirstIndex and NumIndices count points
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	bool bIsPoint = false;
+
+	// index of the element among those rendered by Actor
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	int32 ActorElement = 0;
+
+	// LOD0 section of the actor holding the element
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	int32 SectionIndex = 0;
+
+	// range in the section's index buffer (instance range in instanced line mode)
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	int32 FirstIndex = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	int32 NumIndices = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	FBox Bounds = FBox(ForceInit);
+
+	// hash of the source geometry, unchanged across reimports as long as the element is
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	int64 GeometryHash = 0;
+
+	// combination of layers the element is in (see UBIMScene::GetElementLayers), INDEX_NONE if it has none
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	int32 CategorySet = INDEX_NONE;
+};
+
+/**
+ * Result of a spatial query on a scene: the element found and the point on its surface, in world space
+ */
+USTRUCT(BlueprintType)
+struct DXFRUNTIMEIMPORTER_API FBIMHitResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	FBIMElement Element;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	FVector Normal = FVector::ZeroVector;
+
+	// along the ray for Raycast, from the query point for NearestElement
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Element")
+	float Distance = 0.0f;
+};
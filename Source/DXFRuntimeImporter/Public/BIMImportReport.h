@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMImportReport.generated.h"
+
+/**
+ * Bytes held by one scene, for budgeting memory across scenes
+ */
+USTRUCT(BlueprintType)
+struct DXFRUNTIMEIMPORTER_API FBIMSceneMemory
+{
+	GENERATED_BODY()
+
+	// assimp scene, zero once released
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Memory")
+	int64 SourceBytes = 0;
+
+	// converted buffers kept for respawning, spatial index and element table
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Memory")
+	int64 MeshDataBytes = 0;
+
+	// vertex, index and instance data created for rendering, including the CPU copy RMC's static provider keeps
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Memory")
+	int64 RenderBytes = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Memory")
+	int64 TotalBytes = 0;
+};
+
+/**
+ * What an import did and what it cost, filled in as the scene is imported and spawned
+ */
+USTRUCT(BlueprintType)
+struct DXFRUNTIMEIMPORTER_API FBIMImportReport
+{
+	GENERATED_BODY()
+
+	// stage timings in milliseconds, zero for stages that didn't run
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float DownloadMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float ReadMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float PostProcessMs = 0.0f;
+
+	// PostProcessMs by assimp step (aiProcess_ flag name without the prefix), in the order they ran
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	TMap<FString, float> PostProcessStepMs;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float CacheMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float BuildBuffersMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float SpatialIndexMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float ProxyMs = 0.0f;
+
+	// time spent spawning actors and creating sections, summed over frames when spawning progressively
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	float SpawnMs = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	bool bFromCache = false;
+
+	// source meshes, and actors they are rendered by
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Meshes = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Lines = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 PointClouds = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Actors = 0;
+
+	// reimports only: actors kept because none of their elements changed, and actors of the previous version removed
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 ActorsKept = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 ActorsRemoved = 0;
+
+	// the last reimport found the source unchanged, without downloading or rebuilding anything
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	bool bUnchanged = false;
+
+	// full resolution (LOD0) geometry
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Vertices = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Triangles = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Segments = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Points = 0;
+
+	// degenerate triangles dropped while building buffers
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 TrianglesSkipped = 0;
+
+	// far-field proxies, and the triangles of all of them
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 Proxies = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	int32 ProxyTriangles = 0;
+
+	// memory held by the scene once it was ready
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Report")
+	FBIMSceneMemory Memory;
+};
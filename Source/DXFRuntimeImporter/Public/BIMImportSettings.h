@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMImportSettings.generated.h"
+
+class UStaticMesh;
+
+/**
+ * How line segments are turned into renderable geometry
+ */
+UENUM(BlueprintType)
+enum class EBIMLineRenderMode : uint8
+{
+	// Continuous tubes along connected segments (one ring per joint, caps at free ends), baked into the actor's runtime mesh
+	Tube,
+	// One instance of a shared unit cylinder per segment (hierarchical instanced static mesh)
+	Instanced
+};
+
+/**
+ * Collision generated for imported geometry
+ */
+UENUM(BlueprintType)
+enum class EBIMCollisionMode : uint8
+{
+	None,
+	// Cooked from the coarsest LOD of meshes, and from coarse tubes at the true radius for lines. Lines spawned
+	// without it collide with their full resolution tubes when switched to it later
+	Simplified,
+	// Cooked from the full resolution geometry
+	Full
+};
+
+/**
+ * Assimp post-processing applied to the source file: which steps run and how large meshes are split
+ */
+UENUM(BlueprintType)
+enum class EBIMImportProfile : uint8
+{
+	// The profile set in the plugin config (DefaultImportProfile)
+	ProjectDefault,
+	// Triangulate and split only: no normals, no mesh or graph optimization
+	FastPreview,
+	// Normals, cleanup and mesh merging, meshes split to fit 16-bit indices
+	Balanced,
+	// Every step, including scene graph optimization, with large meshes kept whole
+	Quality
+};
+
+/**
+ * Colors baked into the vertices of imported geometry, for materials reading the vertex color
+ */
+UENUM(BlueprintType)
+enum class EBIMVertexColorMode : uint8
+{
+	// No vertex colors, elements look like the scene's materials
+	None,
+	// Colors of the source vertices where the file has them (DXF entity colors), otherwise the element's material diffuse
+	SourceColors,
+	// One color per layer (the source mesh name in DXF files): LayerColors, or a generated palette for other layers
+	LayerPalette
+};
+
+/**
+ * One level of detail of imported triangle meshes
+ */
+USTRUCT(BlueprintType)
+struct DXFRUNTIMEIMPORTER_API FBIMMeshLODSettings
+{
+	GENERATED_BODY()
+
+	FBIMMeshLODSettings(float InScreenSize = 1.0f, float InTrianglePercent = 1.0f)
+		: ScreenSize(InScreenSize), TrianglePercent(InTrianglePercent)
+	{
+	}
+
+	// Screen size at which this LOD starts being used
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|LOD")
+	float ScreenSize;
+
+	// Fraction of the full resolution triangles kept by the simplifier (ignored for LOD0)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|LOD", meta=(ClampMin="0.01", ClampMax="1.0"))
+	float TrianglePercent;
+};
+
+/**
+ * Options controlling how a BIM scene is imported and built. Passed to UBIMScene::ImportScene
+ */
+USTRUCT(BlueprintType)
+struct DXFRUNTIMEIMPORTER_API FBIMImportSettings
+{
+	GENERATED_BODY()
+
+	FBIMImportSettings()
+	{
+		LineLODScreenSizes = { 1.3f, 0.8f, 0.3f };
+		PointLODScreenSizes = { 1.0f, 0.3f, 0.1f };
+		MeshLODs = { FBIMMeshLODSettings(1.0f, 1.0f), FBIMMeshLODSettings(0.5f, 0.5f), FBIMMeshLODSettings(0.2f, 0.15f) };
+	}
+
+	// Parse and post-process the file on a background task instead of the game thread
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer")
+	bool bAsyncImport = true;
+
+	// Assimp post-processing steps and split limits
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer")
+	EBIMImportProfile ImportProfile = EBIMImportProfile::ProjectDefault;
+
+	// Store converted buffers on disk and reuse them when the same model is imported again with the same settings
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer")
+	bool bUseCache = true;
+
+	// Build a BVH over every triangle and segment for Raycast, QueryBox and NearestElement (no collision needed)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer")
+	bool bBuildSpatialIndex = true;
+
+	// Low-memory resident mode: free the assimp scene and the converted buffers once the actors are built.
+	// The scene can't be spawned again afterwards
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer")
+	bool bReleaseSourceData = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Lines")
+	EBIMLineRenderMode LineRenderMode = EBIMLineRenderMode::Tube;
+
+	// Mesh instanced per segment in Instanced mode. Must be a Z-aligned cylinder, 100 units tall and wide, centered
+	// on its origin (like /Engine/BasicShapes/Cylinder, which is used when empty)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Lines")
+	UStaticMesh* LineInstanceMesh = nullptr;
+
+	// Screen sizes of the tube LODs: full tube, 6-sided tube and open 3-sided prism. Extra entries are ignored
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|LOD")
+	TArray<float> LineLODScreenSizes;
+
+	// Width of the sprite drawn for every point primitive, in centimeters. Each coarser LOD doubles it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Points", meta=(ClampMin="0.1"))
+	float PointSize = 10.0f;
+
+	// Keep point positions as 16 bits per axis within their grid cell (ClusterCellSize / 65535 precision) until spawned
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Points")
+	bool bQuantizePoints = true;
+
+	// Screen sizes of the point LODs. Every LOD keeps a quarter of the points of the previous one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|LOD")
+	TArray<float> PointLODScreenSizes;
+
+	// Point cells smaller than this on screen are not drawn at all, 0 to never cull them
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|LOD", meta=(ClampMin="0.0"))
+	float PointCullScreenSize = 0.02f;
+
+	// Spawn actors over several frames, nearest to the camera first, instead of all in one frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Spawning")
+	bool bProgressiveSpawn = true;
+
+	// Time spent spawning actors and uploading their sections per frame, in milliseconds. At least one actor is
+	// spawned per frame, so very large meshes can exceed it (the Balanced profile splits them)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Spawning", meta=(ClampMin="0.1"))
+	float SpawnBudgetMs = 4.0f;
+
+	// Stream the scene by spatial tiles (merged clusters of ClusterCellSize): render data is built when the camera
+	// comes within StreamingDistance and released when it leaves. Buffers are kept in a local file meanwhile
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Streaming")
+	bool bStreamTiles = false;
+
+	// Distance from the camera to a tile's bounds within which it is loaded, in centimeters
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Streaming", meta=(ClampMin="100.0"))
+	float StreamingDistance = 50000.0f;
+
+	// Ceiling of the render data of loaded tiles. Farther tiles are released to make room for nearer ones
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Streaming", meta=(ClampMin="1"))
+	int32 StreamingMemoryLimitMB = 512;
+
+	// Collision is cooked asynchronously after the scene is spawned, actors closest to the player first
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Collision")
+	EBIMCollisionMode CollisionMode = EBIMCollisionMode::None;
+
+	// Actors whose collision cooking is started per frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Collision", meta=(ClampMin="1"))
+	int32 CollisionActorsPerTick = 8;
+
+	// Bake element colors into vertex colors, so the whole scene can render with one material while keeping element
+	// colors. Elements are then recolored by rewriting their vertex colors (UBIMScene::SetElementColor)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Colors")
+	EBIMVertexColorMode VertexColorMode = EBIMVertexColorMode::None;
+
+	// Colors of LayerPalette mode by layer name
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Colors")
+	TMap<FString, FLinearColor> LayerColors;
+
+	// Merge vertices identical in every stream before building LODs
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Batching")
+	bool bWeldVertices = true;
+
+	// Merge small meshes (and line meshes) into clusters: one actor and one section per cluster
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Batching")
+	bool bMergeMeshes = false;
+
+	// Edge length of the grid cells meshes are clustered by, in centimeters
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Batching", meta=(ClampMin="100.0"))
+	float ClusterCellSize = 10000.0f;
+
+	// Maximum LOD0 vertices (instances in instanced line mode) in one cluster. Bigger meshes stay on their own.
+	// Clusters above 65535 vertices need 32-bit indices
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Batching", meta=(ClampMin="1"))
+	int32 ClusterVertexBudget = 65535;
+
+	// LOD chain of triangle meshes, simplified with quadric error metrics. The first entry is the full mesh
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|LOD")
+	TArray<FBIMMeshLODSettings> MeshLODs;
+
+	// Build a merged, heavily simplified proxy of the meshes and tubes of the scene on the import worker. Farther
+	// than ProxyDistance it is shown instead of the actors it stands in for, so overviews cost a few draw calls
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Proxy")
+	bool bBuildProxy = false;
+
+	// Distance from the camera to a proxy tile's bounds beyond which the proxy replaces its actors, in centimeters.
+	// Streamed scenes should keep it below StreamingDistance, so far tiles are covered until they are released
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Proxy", meta=(ClampMin="100.0"))
+	float ProxyDistance = 100000.0f;
+
+	// Fraction of the triangles of the merged coarsest LODs a proxy keeps
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Proxy", meta=(ClampMin="0.001", ClampMax="1.0"))
+	float ProxyTrianglePercent = 0.1f;
+
+	// Edge length of the tiles the scene gets one proxy per, in centimeters. 0 builds one proxy for the whole scene
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Proxy", meta=(ClampMin="0.0"))
+	float ProxyTileSize = 0.0f;
+};
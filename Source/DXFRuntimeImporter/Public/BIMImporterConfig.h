@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "BIMImportSettings.h"
+#include "BIMImporterConfig.generated.h"
+
+/**
+ * Project-wide defaults of the importer, read from the plugin's DefaultDXFRuntimeImporter.ini
+ */
+UCLASS(config=DXFRuntimeImporter, defaultconfig)
+class DXFRUNTIMEIMPORTER_API UBIMImporterConfig : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	// Profile used by imports whose settings ask for ProjectDefault
+	UPROPERTY(config, EditAnywhere, Category="DXF Importer")
+	EBIMImportProfile DefaultImportProfile = EBIMImportProfile::Quality;
+
+	// Disk space of the converted buffer cache (bUseCache). Least recently used models are deleted beyond it, 0 for no limit
+	UPROPERTY(config, EditAnywhere, Category="DXF Importer|Cache", meta=(ClampMin="0"))
+	int32 CacheSizeLimitMB = 2048;
+
+	// Files of a UBIMSceneManager batch being downloaded, parsed or spawned at the same time
+	UPROPERTY(config, EditAnywhere, Category="DXF Importer|Scene Manager", meta=(ClampMin="1"))
+	int32 MaxConcurrentImports = 4;
+
+	// Worker threads the scene manager parses files and builds buffers on
+	UPROPERTY(config, EditAnywhere, Category="DXF Importer|Scene Manager", meta=(ClampMin="1"))
+	int32 MaxConcurrentParses = 2;
+
+	// Memory all scenes of the scene manager may hold before it stops starting files, 0 for no limit
+	UPROPERTY(config, EditAnywhere, Category="DXF Importer|Scene Manager", meta=(ClampMin="0"))
+	int32 MemoryBudgetMB = 0;
+};
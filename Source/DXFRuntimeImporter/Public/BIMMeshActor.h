@@ -5,9 +5,10 @@
 #include "CoreMinimal.h"
 #include "RuntimeMeshActor.h"
 #include "assimp/mesh.h"
+#include "BIMMeshData.h"
+#include "BIMImportSettings.h"
 #include "BIMMeshActor.generated.h"
 
-// TODO: investigate potential memory leak in BaseMesh
 UCLASS()
 class DXFRUNTIMEIMPORTER_API ABIMMeshActor : public ARuntimeMeshActor
 {
@@ -33,16 +34,67 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient)
 	URuntimeMeshProviderStatic* StaticProvider;
 
+	virtual void BeginDestroy() override;
+
 public:
 	void GenerateMesh(aiMesh* AiMesh);
 
+	/**
+	 * Convert an assimp mesh into render buffers, with the simplified LODs requested in Settings.
+	 * Touches no UObject, so it can run on any thread
+	 */
+	static void BuildMeshBuffers(const aiMesh* AiMesh, const FBIMImportSettings& Settings, FBIMMeshBuffers& OutBuffers);
+
+	/**
+	 * Create the RMC section from buffers built by BuildMeshBuffers. Game thread only
+	 */
+	void CreateMeshFromBuffers(const FBIMMeshBuffers& Buffers, aiMesh* AiMesh);
+
 	UFUNCTION()
 	void SetRefs(float Easting, float Northing, float Altitude);
 
+	/**
+	 * Move the actor so its origin lands at the right place relative to the scene reference point
+	 */
+	void PlaceAtReference(const FBIMOrigin& Reference);
+
+	/**
+	 * Enable (and cook asynchronously) or disable collision. Game thread only
+	 */
+	void SetCollisionMode(EBIMCollisionMode Mode);
+
+	/**
+	 * Rewrite the baked vertex colors of some of this actor's elements (indices among the elements of its buffers).
+	 * False if the actor was built without vertex colors. Game thread only
+	 */
+	bool SetElementColors(const TArray<int32>& Elements, const FLinearColor& Color);
+
+	// Forget the assimp mesh before its scene is freed, the render data stays
+	void ReleaseBaseMesh()
+	{
+		BaseMesh = nullptr;
+	}
+
+	// Bytes of render data created from buffers (vertices, indices or instances)
+	int64 GetRenderMemory() const
+	{
+		return RenderMemory;
+	}
+
 	UFUNCTION(BlueprintCallable)
 	void SetMaterial(UMaterialInstance* MaterialInstance);
 	
 private:
-	// Base mesh
+	// Base mesh, owned by the scene's importer
 	aiMesh* BaseMesh = nullptr;
+
+	// number of sections of every LOD created from buffers
+	TArray<int32> LODSectionCounts;
+	int64 RenderMemory = 0;
+
+	// where each element's vertices are, empty without baked colors
+	FBIMElementVertices ElementVertices;
+
+	// absolute position of the mesh vertices' local zero
+	FBIMOrigin Origin;
 };
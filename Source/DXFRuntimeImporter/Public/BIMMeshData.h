@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PackedNormal.h"
+#include "Math/Vector2DHalf.h"
+#include "BIMImportReport.h"
+
+struct aiScene;
+struct aiMesh;
+
+class URuntimeMeshProviderStatic;
+class FBIMSpatialIndex;
+class FBIMTileStore;
+
+namespace Assimp
+{
+	class Importer;
+}
+
+/**
+ * Vertex and index streams of one runtime mesh section, in the precision they are uploaded with.
+ * Streams the source has no data for are left empty
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMMeshSection
+{
+	TArray<FVector> Positions;
+
+	// tangent Z, 8 bits per component
+	TArray<FPackedNormal> Normals;
+
+	// tangent X, 8 bits per component, W holds the sign of the binormal
+	TArray<FPackedNormal> Tangents;
+
+	TArray<FVector2DHalf> TexCoords;
+
+	// baked element colors (sRGB), empty unless the import asks for vertex colors
+	TArray<FColor> Colors;
+
+	TArray<int32> Triangles;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Positions.GetAllocatedSize() + Normals.GetAllocatedSize() + Tangents.GetAllocatedSize() + TexCoords.GetAllocatedSize() + Colors.GetAllocatedSize() + Triangles.GetAllocatedSize();
+	}
+};
+
+/**
+ * One level of detail: the screen size it starts at and its sections
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMMeshLOD
+{
+	float ScreenSize = 1.0f;
+	TArray<FBIMMeshSection> Sections;
+
+	// first vertex and vertex count of every element in its section, parallel to the buffers' Elements
+	TArray<FIntPoint> ElementVertices;
+};
+
+/**
+ * Double precision position in centimeters, in Unreal axes (X northing, Y easting, Z altitude) and absolute UTM
+ * coordinates. Actor origins and the scene reference use it, so float vertices only ever hold local offsets
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMOrigin
+{
+	double X = 0.0;
+	double Y = 0.0;
+	double Z = 0.0;
+
+	FBIMOrigin()
+	{
+	}
+
+	FBIMOrigin(double InX, double InY, double InZ) : X(InX), Y(InY), Z(InZ)
+	{
+	}
+
+	// From a UTM point in meters
+	static FBIMOrigin FromUTM(double Easting, double Northing, double Altitude)
+	{
+		return FBIMOrigin(Northing * 100.0, Easting * 100.0, Altitude * 100.0);
+	}
+
+	// Center of the bounds of an assimp mesh
+	static FBIMOrigin FromMeshBounds(const aiMesh* AiMesh);
+
+	// An assimp vertex (meters, x easting, y northing) relative to this origin, in centimeters and Unreal axes
+	FORCEINLINE FVector ToLocal(double SourceX, double SourceY, double SourceZ) const
+	{
+		return FVector(
+			static_cast<float>(SourceY * 100.0 - X),
+			static_cast<float>(SourceX * 100.0 - Y),
+			static_cast<float>(SourceZ * 100.0 - Z)
+		);
+	}
+
+	// Offset from Other to this. Only precise for nearby points, like an origin and the scene reference
+	FORCEINLINE FVector operator-(const FBIMOrigin& Other) const
+	{
+		return FVector(static_cast<float>(X - Other.X), static_cast<float>(Y - Other.Y), static_cast<float>(Z - Other.Z));
+	}
+};
+
+/**
+ * Where one source aiMesh ended up inside (possibly merged) buffers. Ranges refer to LOD0
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMElementRange
+{
+	// index into the scene's MeshObjs / LineObjs / PointObjs
+	int32 SourceIndex = INDEX_NONE;
+
+	// hash of the source geometry the element was built from, the same in every version of a file it didn't change in
+	uint64 GeometryHash = 0;
+
+	// index into FBIMCategories::Sets, INDEX_NONE if the element has no layer
+	int32 CategorySet = INDEX_NONE;
+	int32 SectionIndex = 0;
+
+	// first index and index count in the section's triangle list (instances in instanced line mode, points in point buffers)
+	int32 FirstIndex = 0;
+	int32 NumIndices = 0;
+
+	// range in SegmentPoints (line buffers only), in segments
+	int32 FirstSegment = 0;
+	int32 NumSegments = 0;
+
+	FBox Bounds = FBox(ForceInit);
+};
+
+/**
+ * Layers of the source: the mesh names DXF layers become, and the names of the group nodes above every mesh.
+ * Elements refer to their distinct combination of layers by index, so toggling a layer tests every combination
+ * once instead of every element
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMCategories
+{
+	TArray<FString> Names;
+
+	// distinct combinations of layers, as sorted indices into Names
+	TArray<TArray<int32>> Sets;
+
+	// combination of every source mesh, parallel to MeshObjs / LineObjs / PointObjs
+	TArray<int32> MeshSets;
+	TArray<int32> LineSets;
+	TArray<int32> PointSets;
+
+	// Combination of a source mesh, INDEX_NONE if unknown
+	static int32 GetSet(const TArray<int32>& SourceSets, int32 SourceIndex)
+	{
+		return SourceSets.IsValidIndex(SourceIndex) ? SourceSets[SourceIndex] : INDEX_NONE;
+	}
+
+	SIZE_T GetAllocatedSize() const;
+};
+
+/**
+ * Render buffers of one actor: a single aiMesh, or a cluster of them when merging is enabled
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMRenderBuffers
+{
+	// LOD0 is the full resolution mesh, further LODs are coarser
+	TArray<FBIMMeshLOD> LODs;
+
+	// source elements contained in these buffers
+	TArray<FBIMElementRange> Elements;
+
+	// vertices, bounds and element bounds are relative to this origin
+	FBIMOrigin Origin;
+
+	// assimp material of the source mesh (before merging), and bounds of all LOD0 vertices
+	int32 MaterialIndex = 0;
+	FBox Bounds = FBox(ForceInit);
+
+	SIZE_T GetAllocatedSize() const;
+};
+
+/**
+ * Converted render buffers of triangle meshes (origin offset, axis swap and centimeter scaling applied).
+ * Plain data: built on any thread before the owning actor exists
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMMeshBuffers : public FBIMRenderBuffers
+{
+	// degenerate triangles dropped while building
+	int32 TrianglesSkipped = 0;
+};
+
+/**
+ * Converted render buffers of line meshes, either as tube geometry for each LOD
+ * or as one unit-cylinder instance transform per segment
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMLineBuffers : public FBIMRenderBuffers
+{
+	// instanced render mode only
+	TArray<FTransform> InstanceTransforms;
+
+	// both end points of every segment, for the spatial index
+	TArray<FVector> SegmentPoints;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return FBIMRenderBuffers::GetAllocatedSize() + InstanceTransforms.GetAllocatedSize() + SegmentPoints.GetAllocatedSize();
+	}
+};
+
+/**
+ * Positions of point primitives in one grid cell, expanded into sprites only when the actor is spawned.
+ * Points are in Morton order inside every element, so any stride through them still covers the whole cell
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMPointBuffers : public FBIMRenderBuffers
+{
+	// full precision positions, or 16 bits per axis within Bounds (three per point) when quantized
+	TArray<FVector> Points;
+	TArray<uint16> QuantizedPoints;
+
+	int32 NumPoints() const
+	{
+		return Points.Num() > 0 ? Points.Num() : QuantizedPoints.Num() / 3;
+	}
+
+	FVector GetPoint(int32 Index) const;
+
+	// Size of one quantization step along every axis
+	FVector GetQuantizationStep() const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return FBIMRenderBuffers::GetAllocatedSize() + Points.GetAllocatedSize() + QuantizedPoints.GetAllocatedSize();
+	}
+};
+
+/**
+ * Far-field stand-in for the meshes and tubes of one proxy tile in the same layers: their coarsest LODs merged
+ * into a single, further simplified section. Has no elements of its own
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMProxyBuffers : public FBIMMeshBuffers
+{
+	// tile and layer combination the proxy stands in for, see FBIMProxyBuilder::GetTile
+	FIntVector Tile = FIntVector::ZeroValue;
+	int32 CategorySet = INDEX_NONE;
+};
+
+/**
+ * Vertex ranges of the elements of one actor in every LOD, kept by actors with baked colors to recolor elements
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMElementVertices
+{
+	// section of every element, and its (first vertex, vertex count) in that section per LOD
+	TArray<int32> Sections;
+	TArray<TArray<FIntPoint>> LODRanges;
+
+	// Keep the element ranges of Buffers, if its sections have baked colors
+	void Init(const FBIMRenderBuffers& Buffers);
+
+	bool IsEmpty() const
+	{
+		return Sections.Num() == 0;
+	}
+
+	// Overwrite the vertex colors of Elements in every LOD and re-upload the sections they are in. Game thread only
+	void SetColor(URuntimeMeshProviderStatic* Provider, const TArray<int32>& Elements, FColor Color) const;
+};
+
+/**
+ * Fill the color stream of every section of Buffers with Color, keeping colors baked from the source. Thread-safe
+ */
+DXFRUNTIMEIMPORTER_API void BakeBIMColor(FBIMRenderBuffers& Buffers, FColor Color);
+
+/**
+ * Merge vertices that are identical in every stream and remap the triangles. Thread-safe
+ */
+DXFRUNTIMEIMPORTER_API void WeldBIMSection(FBIMMeshSection& Section);
+
+/**
+ * Configure the provider's LODs and create every section of them, with 16-bit indices where they fit. Game thread only
+ */
+DXFRUNTIMEIMPORTER_API void CreateBIMSections(URuntimeMeshProviderStatic* Provider, const TArray<FBIMMeshLOD>& LODs);
+
+/**
+ * Bytes of vertex and index buffers CreateBIMSections uploads for LODs, plus the CPU copy of them that
+ * URuntimeMeshProviderStatic keeps for reading sections back
+ */
+DXFRUNTIMEIMPORTER_API int64 GetBIMRenderSize(const TArray<FBIMMeshLOD>& LODs);
+
+/**
+ * Make the sections of one LOD the provider's collision mesh, cooked asynchronously. Game thread only
+ */
+DXFRUNTIMEIMPORTER_API void EnableBIMCollision(URuntimeMeshProviderStatic* Provider, int32 LODIndex, int32 NumSections);
+
+/**
+ * Everything produced by the import pipeline before actors are spawned. Handed from
+ * the import task to the game thread
+ */
+struct DXFRUNTIMEIMPORTER_API FBIMImportResult
+{
+	// owns Scene, null when the buffers were loaded from the cache
+	TSharedPtr<Assimp::Importer, ESPMode::ThreadSafe> Importer;
+	const aiScene* Scene = nullptr;
+	bool bFromCache = false;
+
+	// the cache entry the source was looked up by could not be loaded, it has to be downloaded after all
+	bool bCacheFailed = false;
+
+	// version of the source the buffers were built from, empty if unknown
+	FString Version;
+
+	// the server's ETag or Last-Modified of Version, empty if it sent neither or the source is local
+	FString ServerVersion;
+
+	// bytes held by the importer for Scene
+	int64 SourceBytes = 0;
+
+	TArray<aiMesh*> MeshObjs;
+	TArray<aiMesh*> LineObjs;
+	TArray<aiMesh*> PointObjs;
+
+	// names of the source meshes, parallel to MeshObjs / LineObjs / PointObjs (which are empty on cache hits)
+	TArray<FString> MeshNames;
+	TArray<FString> LineNames;
+	TArray<FString> PointNames;
+
+	// one entry per actor to spawn: parallel to MeshObjs / LineObjs, or merged clusters of them
+	TArray<FBIMMeshBuffers> MeshBuffers;
+	TArray<FBIMLineBuffers> LineBuffers;
+
+	// one entry per grid cell holding points
+	TArray<FBIMPointBuffers> PointBuffers;
+
+	// layers of the source meshes, every element of a buffer has the same combination of them
+	FBIMCategories Categories;
+
+	// one per proxy tile, empty unless the settings ask for proxies
+	TArray<FBIMProxyBuffers> ProxyBuffers;
+
+	// built from the buffers above, null if disabled in the settings
+	TSharedPtr<FBIMSpatialIndex, ESPMode::ThreadSafe> SpatialIndex;
+
+	// the buffers written out as streamable tiles, null unless streaming is enabled
+	TSharedPtr<FBIMTileStore, ESPMode::ThreadSafe> TileStore;
+
+	// timings and counts of the stages run on the worker
+	FBIMImportReport Report;
+};
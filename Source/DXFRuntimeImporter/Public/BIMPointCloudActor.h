@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeMeshActor.h"
+#include "assimp/mesh.h"
+#include "BIMMeshData.h"
+#include "BIMImportSettings.h"
+#include "BIMPointCloudActor.generated.h"
+
+/**
+ * Point primitives of one grid cell, drawn as one small horizontal triangle per point. UV0 holds every corner's
+ * offset from its point in point radii (inside the round dot where its length is below 1), so materials can mask
+ * the triangle into a dot or turn it to face the camera
+ */
+UCLASS()
+class DXFRUNTIMEIMPORTER_API ABIMPointCloudActor : public ARuntimeMeshActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	ABIMPointCloudActor();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UMaterialInterface* Material;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float RefEasting;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float RefNorthing;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float RefAltitude;
+
+protected:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient)
+	URuntimeMeshProviderStatic* StaticProvider;
+
+	virtual void BeginDestroy() override;
+
+public:
+	/**
+	 * Bucket the points of every assimp point mesh into grid cells of Settings.ClusterCellSize, one buffer per cell
+	 * and combination of layers (CategorySets, parallel to PointObjs) with an element per source mesh.
+	 * Touches no UObject, so it can run on any thread
+	 */
+	static void BuildPointBuffers(const TArray<aiMesh*>& PointObjs, const TArray<int32>& CategorySets, const FBIMImportSettings& Settings, TArray<FBIMPointBuffers>& OutBuffers);
+
+	/**
+	 * Expand the points into the sprite LODs of Settings and create their RMC sections. Game thread only
+	 */
+	void CreateMeshFromBuffers(const FBIMPointBuffers& Buffers, const FBIMImportSettings& Settings);
+
+	UFUNCTION()
+	void SetRefs(float Easting, float Northing, float Altitude);
+
+	/**
+	 * Move the actor so its origin lands at the right place relative to the scene reference point
+	 */
+	void PlaceAtReference(const FBIMOrigin& Reference);
+
+	// Bytes of render data created from buffers
+	int64 GetRenderMemory() const
+	{
+		return RenderMemory;
+	}
+
+	UFUNCTION(BlueprintCallable)
+	void SetMaterial(UMaterialInstance* MaterialInstance);
+
+private:
+	int64 RenderMemory = 0;
+
+	// absolute position of the points' local zero
+	FBIMOrigin Origin;
+};
@@ -5,8 +5,13 @@
 #include "CoreMinimal.h"
 #include "RuntimeMeshActor.h"
 #include "assimp/mesh.h"
+#include "BIMMeshData.h"
+#include "BIMImportSettings.h"
 #include "BIMPolyLineActor.generated.h"
 
+class UHierarchicalInstancedStaticMeshComponent;
+struct FRuntimeMeshCollisionData;
+
 UCLASS()
 class DXFRUNTIMEIMPORTER_API ABIMPolyLineActor : public ARuntimeMeshActor
 {
@@ -32,17 +37,90 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient)
 	URuntimeMeshProviderStatic* StaticProvider;
 
+	// Only created in instanced render mode
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient)
+	UHierarchicalInstancedStaticMeshComponent* InstancedLines;
+
+	// Unit cylinder drawn per segment in instanced render mode
+	UPROPERTY(Transient)
+	UStaticMesh* InstanceMesh;
+
+	virtual void BeginDestroy() override;
+
 public:
 	void GenerateMesh(aiMesh* AiMesh);
 
+	/**
+	 * Convert the segments of an assimp line mesh into tube LODs (or instance transforms, depending on Settings).
+	 * Touches no UObject, so it can run on any thread
+	 */
+	static void BuildLineBuffers(const aiMesh* AiMesh, const FBIMImportSettings& Settings, FBIMLineBuffers& OutBuffers);
+
+	// Radius of full resolution tubes and instanced cylinders, in centimeters
+	static float GetLineRadius();
+
+	/**
+	 * Create the RMC LOD sections from buffers built by BuildLineBuffers. With bCollisionTube, tubes keep their
+	 * segments until the first simplified collision is built from them. Game thread only
+	 */
+	void CreateMeshFromBuffers(const FBIMLineBuffers& Buffers, aiMesh* AiMesh, bool bCollisionTube = false);
+
 	UFUNCTION()
 	void SetRefs(float Easting, float Northing, float Altitude);
 
+	/**
+	 * Move the actor so its origin lands at the right place relative to the scene reference point
+	 */
+	void PlaceAtReference(const FBIMOrigin& Reference);
+
+	/**
+	 * Enable (and cook asynchronously) or disable collision. Game thread only
+	 */
+	void SetCollisionMode(EBIMCollisionMode Mode);
+
+	/**
+	 * Rewrite the baked vertex colors of some of this actor's elements (indices among the elements of its buffers).
+	 * False if the actor was built without vertex colors. Game thread only
+	 */
+	bool SetElementColors(const TArray<int32>& Elements, const FLinearColor& Color);
+
+	// Forget the assimp mesh before its scene is freed, the render data stays
+	void ReleaseBaseMesh()
+	{
+		BaseMesh = nullptr;
+	}
+
+	// Bytes of render data created from buffers (vertices, indices or instances)
+	int64 GetRenderMemory() const
+	{
+		return RenderMemory;
+	}
+
 	UFUNCTION(BlueprintCallable)
 	void SetMaterial(UMaterialInstance* MaterialInterface);
+
+	// Set the unit cylinder used in instanced render mode (defaults to the engine cylinder)
+	UFUNCTION()
+	void SetInstanceMesh(UStaticMesh* Mesh);
 	
 private:
-	// Base mesh
+	// Base mesh, owned by the scene's importer
 	aiMesh* BaseMesh = nullptr;
+
+	// number of sections of every LOD created from buffers
+	TArray<int32> LODSectionCounts;
+	int64 RenderMemory = 0;
+
+	// where each element's vertices are, empty without baked colors
+	FBIMElementVertices ElementVertices;
+
+	// absolute position of the segments' local zero
+	FBIMOrigin Origin;
+
+	// both end points of every segment, kept by tube actors until their simplified collision is built
+	TArray<FVector> SegmentPoints;
+
+	// Open tube of COLLISION_SECTOR_COUNT sides at the line radius along every segment chain
+	void BuildCollisionTube(FRuntimeMeshCollisionData& OutCollision) const;
 };
 
@@ -5,11 +5,24 @@
 #include "CoreMinimal.h"
 #include "BIMMeshActor.h"
 #include "BIMPolyLineActor.h"
+#include "BIMPointCloudActor.h"
+#include "BIMImportSettings.h"
+#include "BIMMeshData.h"
+#include "BIMElement.h"
+#include "BIMImportReport.h"
 #include "CoreUObject/Public/UObject/Object.h"
 #include "assimp/scene.h"
 #include "HttpModule.h"
 #include "BIMScene.generated.h"
 
+class FBIMSpatialIndex;
+class FBIMTileStore;
+class FQueuedThreadPool;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FBIMSceneReadyDelegate, UBIMScene*, Scene);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FBIMSceneFailedDelegate, UBIMScene*, Scene, const FString&, Error);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FBIMSceneProgressDelegate, UBIMScene*, Scene, int32, SpawnedActors, int32, TotalActors);
+
 /**
  * The UAIScene class imports a DXF (or other supported format) scene using the assimp
  * library. A file path, UTM reference coordinates and an outer object reference are required
@@ -21,10 +34,22 @@ class DXFRUNTIMEIMPORTER_API UBIMScene : public UObject
 
 public:
 	/**
-	 * Import scene (assimp supported file) from given path and automatically render it.
+	 * Import scene (assimp supported file) from given path and automatically render it. Local paths and
+	 * file:// URLs are memory-mapped, other URLs are streamed to a temporary file first.
+	 * OnSceneReady or OnSceneFailed is broadcast once the scene has been spawned (or has failed)
 	 */
-	UFUNCTION(BlueprintCallable, Category="DXF Importer")
-	static UBIMScene* ImportScene(FString BIMUrl, float RefEasting, float RefNorthing, float RefAltitude, UMaterialInstance* MeshMaterial, UMaterialInstance* LineMaterial, UObject* Outer);
+	UFUNCTION(BlueprintCallable, Category="DXF Importer", meta=(AutoCreateRefTerm="Settings"))
+	static UBIMScene* ImportScene(FString BIMUrl, float RefEasting, float RefNorthing, float RefAltitude, UMaterialInstance* MeshMaterial, UMaterialInstance* LineMaterial, UObject* Outer, const FBIMImportSettings& Settings);
+
+	/**
+	 * Check the source for a new version and apply only what changed. Actors whose elements all hash the same are
+	 * kept as they are, the others are spawned (progressively if enabled) and the actors they replace are removed
+	 * once they are in. Remote sources are fetched with a conditional GET on the server's ETag or Last-Modified,
+	 * or downloaded again if it sent neither. Streamed scenes are rebuilt completely. OnSceneReady or OnSceneFailed
+	 * is broadcast when done. Returns false while an import runs
+	 */
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	bool Reimport();
 
 	/**
 	 * Build and spawn triangle meshes contained in this scene
@@ -33,10 +58,16 @@ public:
 	void SpawnMeshes();
 	
 	/**
-	 * Build and spawn point and line drawings contained in this scene
+	 * Build and spawn line drawings contained in this scene
 	 */
 	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
 	void SpawnLines();
+
+	/**
+	 * Build and spawn point primitives contained in this scene (survey points), one point cloud per grid cell
+	 */
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	void SpawnPoints();
 	
 	/**
 	 * Return an array containing pointers to every mesh in this scene
@@ -50,6 +81,113 @@ public:
 	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
 	TArray<ABIMPolyLineActor*> GetAllPolyLines();
 
+	/**
+	* Return an array containing pointers to every point cloud in this scene
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	TArray<ABIMPointCloudActor*> GetAllPointClouds();
+
+	/**
+	* Move the scene reference point (UTM, meters). Actors are moved, their vertices are not rebuilt
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	void SetReference(float Easting, float Northing, float Altitude);
+
+	/**
+	* Double precision version of SetReference, for references blueprint floats can't hold
+	*/
+	void SetReferenceOrigin(const FBIMOrigin& Reference);
+
+	/**
+	* Return every BIM element (source mesh) of this scene and the actor it is rendered by
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	TArray<FBIMElement> GetAllElements();
+
+	/**
+	* Return the elements whose source mesh has the given name
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	TArray<FBIMElement> FindElementsByName(const FString& Name);
+
+	/**
+	* Return the elements rendered by a mesh or polyline actor (several when meshes are merged)
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	TArray<FBIMElement> GetElementsOfActor(AActor* Actor);
+
+	/**
+	* Closest element hit by the segment from Start to End (world space). Uses the spatial index, not collision
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Query")
+	bool Raycast(const FVector& Start, const FVector& End, FBIMHitResult& OutHit);
+
+	/**
+	* Elements with a triangle or line segment whose bounds overlap Box (world space)
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Query")
+	TArray<FBIMElement> QueryBox(const FBox& Box);
+
+	/**
+	* Element with the surface point closest to Location, if one is within MaxDistance
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Query")
+	bool NearestElement(const FVector& Location, float MaxDistance, FBIMHitResult& OutHit);
+
+	/**
+	* Change the collision of every actor. Cooking happens asynchronously over the next frames, nearest actors first
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	void SetCollisionMode(EBIMCollisionMode Mode);
+
+	/**
+	* Recolor elements by rewriting their baked vertex colors, in every LOD. Needs a VertexColorMode other than None.
+	* Streamed tiles get their imported colors back when they are loaded again
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	void SetElementColor(const TArray<FBIMElement>& Targets, FLinearColor Color);
+
+	/**
+	* Show or hide the elements of a layer: a DXF layer, or a group node of other formats. Elements in several layers
+	* are shown while none of them is hidden. Clusters never mix layers, so whole actors are toggled, and only those
+	* whose state changes. Layers hidden before the scene (or a reimport) is ready stay hidden
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Layers")
+	void SetLayerVisible(const FString& Layer, bool bVisible);
+
+	/**
+	* SetLayerVisible for several layers, in a single pass over the actors
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Layers")
+	void SetLayersVisible(const TArray<FString>& Layers, bool bVisible);
+
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Layers")
+	bool IsLayerVisible(const FString& Layer) const;
+
+	/**
+	* Names of every layer of the scene
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Layers")
+	TArray<FString> GetLayers() const;
+
+	/**
+	* Layers an element is in
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Layers")
+	TArray<FString> GetElementLayers(const FBIMElement& Element) const;
+
+	/**
+	* Bytes currently held by this scene and its actors
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	FBIMSceneMemory GetMemoryUsage() const;
+
+	/**
+	* Free the assimp scene and the converted buffers. Actors keep rendering, but can't be spawned again
+	*/
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene")
+	void ReleaseSourceData();
+
 	/**
 	* Hide scene
 	*/
@@ -57,11 +195,26 @@ public:
 	void HideScene();
 
 	/**
-	* Show scene
+	* Show scene, except the layers that are hidden
 	*/
 	UFUNCTION(BlueprintCallable, Category = "DXF Importer|Scene")
 	void ShowScene();
 
+	/**
+	* Run the import task on Pool instead of the global thread pool. Imports start on a later tick,
+	* so this takes effect when called right after ImportScene. If Pool is destroyed before the import ran,
+	* the import moves to the global thread pool
+	*/
+	void SetThreadPool(FQueuedThreadPool* Pool);
+
+	// Path or URL the scene was imported from
+	UPROPERTY(VisibleAnywhere,BlueprintReadOnly)
+	FString BIMUrl;
+
+	// Version of the source the scene shows: the server's ETag or Last-Modified, the file's size and time, or a hash of its content
+	UPROPERTY(VisibleAnywhere,BlueprintReadOnly)
+	FString SourceVersion;
+
 	UPROPERTY(VisibleAnywhere,BlueprintReadOnly)
 	float RefEasting;
 	
@@ -74,24 +227,67 @@ public:
 	UPROPERTY(VisibleAnywhere,BlueprintReadWrite)
 	UMaterialInstance* MeshMaterial;
 	
+	// Also used by point clouds
 	UPROPERTY(VisibleAnywhere,BlueprintReadWrite)
 	UMaterialInstance* LineMaterial;
 	
 	// The outer object that parents the scene (useful for GC and spawning)
 	UPROPERTY(VisibleAnywhere,BlueprintReadOnly)
 	UObject* Outer;
+
+	UPROPERTY(VisibleAnywhere,BlueprintReadOnly)
+	FBIMImportSettings Settings;
+
+	// Stage timings, geometry counts and memory of the import, complete once OnSceneReady fires
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="DXF Importer|Scene")
+	FBIMImportReport ImportReport;
+
+	// Fired on the game thread once every actor of the scene has been spawned
+	UPROPERTY(BlueprintAssignable, Category="DXF Importer|Scene")
+	FBIMSceneReadyDelegate OnSceneReady;
+
+	// Fired after every frame of progressive spawning
+	UPROPERTY(BlueprintAssignable, Category="DXF Importer|Scene")
+	FBIMSceneProgressDelegate OnSpawnProgress;
+
+	// Fired on the game thread if the download or the import fails
+	UPROPERTY(BlueprintAssignable, Category="DXF Importer|Scene")
+	FBIMSceneFailedDelegate OnSceneFailed;
 	
 protected:
 	virtual void BeginDestroy() override;
 	
 private:
-	const aiScene* BaseScene;
+	// owns BaseScene, MeshObjs, LineObjs and PointObjs
+	TSharedPtr<Assimp::Importer, ESPMode::ThreadSafe> Importer;
+	const aiScene* BaseScene = nullptr;
+	int64 SourceBytes = 0;
+
+	// pool running the import task, the global one if null
+	FQueuedThreadPool* ThreadPool = nullptr;
+
+	// set from the start of an import (or reimport) until the scene is ready or failed
+	bool bImporting = false;
+	bool bReimporting = false;
 
 	// underlying assimp triangle mesh
 	TArray<aiMesh*> MeshObjs;
 
 	// underlying assimp line mesh objects
 	TArray<aiMesh*> LineObjs;
+
+	// underlying assimp point mesh objects
+	TArray<aiMesh*> PointObjs;
+
+	// source mesh names, parallel to MeshObjs / LineObjs / PointObjs (kept when the scene comes from the cache)
+	TArray<FString> MeshNames;
+	TArray<FString> LineNames;
+	TArray<FString> PointNames;
+
+	// render buffers built off the game thread, consumed by SpawnMeshes / SpawnLines / SpawnPoints
+	TArray<FBIMMeshBuffers> MeshBuffers;
+	TArray<FBIMLineBuffers> LineBuffers;
+	TArray<FBIMPointBuffers> PointBuffers;
 	
 	UPROPERTY(Transient)
 	TArray<ABIMMeshActor*> MeshActors;
@@ -99,6 +295,189 @@ private:
 	UPROPERTY(Transient)
 	TArray<ABIMPolyLineActor*> LineActors;
 
-	// HTTP Callback when BIM model is received
-	void OnBIMDownloaded(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	UPROPERTY(Transient)
+	TArray<ABIMPointCloudActor*> PointActors;
+
+	// side table resolving actors and section ranges back to source meshes. During progressive
+	// spawning, elements of actors not spawned yet have no actor
+	UPROPERTY(Transient)
+	TArray<FBIMElement> Elements;
+
+	// world origin of the scene, in absolute coordinates
+	FBIMOrigin ReferenceOrigin;
+
+	// layers of the elements. Hidden layers are kept by name, so they apply to later imports of the scene too
+	FBIMCategories Categories;
+	TSet<FString> HiddenLayers;
+
+	// one bit per combination of layers in Categories, set if any of its layers is hidden
+	TBitArray<> HiddenSets;
+
+	// HideScene was called, layers can't show anything until ShowScene
+	bool bSceneHidden = false;
+
+	// Recompute HiddenSets from HiddenLayers
+	void UpdateHiddenSets();
+
+	// Hide or show the actors whose state differs from the one of their layers
+	void UpdateVisibility();
+
+	bool IsSetHidden(int32 CategorySet) const
+	{
+		return bSceneHidden || (HiddenSets.IsValidIndex(CategorySet) && HiddenSets[CategorySet]);
+	}
+
+	// Hidden by the scene, its layers or the proxy standing in for it
+	bool IsActorHidden(AActor* Actor, int32 CategorySet) const;
+
+	// far-field stand-in of one proxy tile, shown instead of the tile's actors while the view is far from it
+	struct FBIMProxyTile
+	{
+		TWeakObjectPtr<ABIMMeshActor> Actor;
+		FBIMOrigin Origin;
+		FBox Bounds = FBox(ForceInit);
+		int32 CategorySet = INDEX_NONE;
+		bool bShowProxy = false;
+	};
+	TArray<FBIMProxyTile> ProxyTiles;
+	TMap<TTuple<FIntVector, int32>, int32> ProxyTileIndices;
+
+	// proxy tile of every actor a proxy stands in for
+	TMap<TWeakObjectPtr<AActor>, int32> ProxiedActors;
+	FDelegateHandle ProxyTickerHandle;
+
+	// Replace the proxies of the previous version by actors for Buffers (which are consumed), before the actors they stand in for are spawned
+	void SpawnProxies(TArray<FBIMProxyBuffers>& Buffers);
+	void ClearProxies();
+
+	// Show the proxies of tiles beyond Settings.ProxyDistance instead of their actors
+	bool TickProxies(float DeltaTime);
+
+	// BVH over every triangle and segment, element ids index Elements. Points are not indexed
+	TSharedPtr<FBIMSpatialIndex, ESPMode::ThreadSafe> SpatialIndex;
+
+	// actors (and their bounds) still waiting for Settings.CollisionMode to be applied
+	TArray<TPair<TWeakObjectPtr<AActor>, FBox>> CollisionQueue;
+	FDelegateHandle CollisionTickerHandle;
+
+	// buffers waiting to be spawned progressively, and their squared distance to the view
+	enum class EBIMSpawnKind : uint8
+	{
+		Mesh,
+		Line,
+		Point
+	};
+	struct FBIMSpawnItem
+	{
+		EBIMSpawnKind Kind;
+		int32 BufferIndex;
+		int32 FirstElement;
+		float Distance;
+	};
+	TArray<FBIMSpawnItem> SpawnQueue;
+	int32 SpawnTotal = 0;
+	FDelegateHandle SpawnTickerHandle;
+
+	// Spawn the actor of one buffer, recording its elements from FirstElement on
+	ABIMMeshActor* SpawnMeshActor(const FBIMMeshBuffers& Buffers, int32 FirstElement);
+	ABIMPolyLineActor* SpawnLineActor(const FBIMLineBuffers& Buffers, int32 FirstElement);
+	ABIMPointCloudActor* SpawnPointActor(const FBIMPointBuffers& Buffers, int32 FirstElement);
+	void SpawnItem(const FBIMSpawnItem& Item);
+
+	// Queue every buffer and spawn them over the next frames, nearest to the view first
+	void StartProgressiveSpawn();
+
+	// Spawn actors until the frame budget is used up
+	bool TickSpawn(float DeltaTime);
+
+	// Drop buffers once spawned, unless they can't be rebuilt (cache hits)
+	void ReleaseSpawnedBuffers();
+
+	// Identity of what an actor renders: its kind and the geometry hashes of its elements, in order
+	static uint64 GetActorSignature(EBIMSpawnKind Kind, const TArray<uint64>& GeometryHashes);
+
+	// Actors of the current version by signature, candidates to be kept by a reimport
+	void CollectReusableActors(TMultiMap<uint64, AActor*>& OutActors) const;
+
+	// Take an actor out of Reusable that renders exactly what Buffers hold, null if there is none
+	static AActor* TakeReusableActor(TMultiMap<uint64, AActor*>& Reusable, const FBIMRenderBuffers& Buffers, EBIMSpawnKind Kind);
+
+	// Rebuild the element table for the new buffers, keeping the actors of unchanged buffers and spawning the rest
+	void ReimportActors(TMultiMap<uint64, AActor*>& Reusable);
+
+	// Stop streaming and destroy every actor and element, for streamed scenes that are reimported
+	void ClearActors();
+
+	// kept by the running reimport, and previous versions of replaced actors, destroyed once the new ones are in
+	TSet<AActor*> KeptActors;
+	TArray<TWeakObjectPtr<AActor>> RetiredActors;
+
+	// End a reimport that found the source unchanged
+	void FinishUnchanged();
+
+	// Release source data if asked to, start collision and report the scene ready
+	void FinishSpawn();
+
+	// Location of the first player's view, or the world origin
+	FVector GetViewLocation() const;
+
+	// local store and load state of streamed tiles
+	struct FBIMTileState
+	{
+		TWeakObjectPtr<AActor> Actor;
+		bool bLoaded = false;
+		bool bBroken = false;
+	};
+	TSharedPtr<FBIMTileStore, ESPMode::ThreadSafe> TileStore;
+	TArray<FBIMTileState> TileStates;
+	int64 StreamedBytes = 0;
+	FDelegateHandle StreamingTickerHandle;
+
+	// Fill the element table from the buffers, spawn the point clouds (which stay resident), free the buffers
+	// and start loading tiles around the view
+	void StartStreaming();
+
+	// Release tiles out of range and load those in range, nearest first, within the frame and memory budgets
+	bool TickStreaming(float DeltaTime);
+
+	void LoadTile(int32 TileIndex);
+	void UnloadTile(int32 TileIndex);
+
+	// Queue every actor for collision with the current mode
+	void QueueCollision();
+	void QueueActorCollision(AActor* Actor);
+
+	// Apply collision to the actors nearest to the player, a few per frame
+	bool TickCollision(float DeltaTime);
+
+	// Callback with the server's version of the model (empty if unknown), loads it from the cache or downloads it
+	void OnBIMVersionReceived(const FString& Version);
+
+	// Download the model to a temporary file. With a CurrentVersion, nothing is downloaded while the server still has it
+	void DownloadFile(const FString& Version, const FString& CurrentVersion);
+	double DownloadStartTime = 0.0;
+
+	// ETag or Last-Modified the server reported for SourceVersion, empty for local files and servers that sent neither.
+	// Unlike SourceVersion, never a hash, so it can be sent back in a conditional request
+	FString ServerVersion;
+
+	// Callback when the BIM model has been downloaded to FilePath
+	void OnBIMDownloaded(bool bWasSuccessful, const FString& FilePath, const FString& Version);
+
+	// Import a model file on disk, deleting it afterwards if it is a temporary download.
+	// Version identifies its content for the cache, the content is hashed if empty. InServerVersion is the
+	// ETag or Last-Modified of a download, if any
+	void ImportFile(const FString& FilePath, bool bTemporary, const FString& Version, const FString& InServerVersion);
+
+	// Run an import task on a worker (or inline if async import is off) and hand its result to OnBIMImported
+	void RunImportTask(TFunction<TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe>()> RunImport);
+
+	// Called on the game thread once assimp is done with the file (Result->Scene is null on failure)
+	void OnBIMImported(TSharedPtr<FBIMImportResult, ESPMode::ThreadSafe> Result);
+
+	// Record the elements of freshly spawned buffers
+	void AddElements(const FBIMRenderBuffers& Buffers, const TArray<FString>& Names, AActor* Actor, bool bIsLine, int32 FirstElement);
+
+	// Broadcast failure and release the scene for garbage collection
+	void FailImport(const FString& Error);
 };
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "BIMImportSettings.h"
+#include "BIMImportReport.h"
+#include "BIMSceneManager.generated.h"
+
+class UBIMScene;
+class UMaterialInstance;
+class FQueuedThreadPool;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FBIMBatchCompleteDelegate, int32, BatchId, const TArray<UBIMScene*>&, Scenes, const TArray<FString>&, FailedUrls);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FBIMBatchProgressDelegate, int32, BatchId, int32, CompletedFiles, int32, TotalFiles);
+
+/**
+ * One ImportBatch call: shared import parameters and the outcome of every file
+ */
+USTRUCT()
+struct FBIMSceneBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FString> Urls;
+
+	// parallel to Urls, null until the file is ready or if it failed
+	UPROPERTY()
+	TArray<UBIMScene*> Scenes;
+
+	UPROPERTY()
+	TArray<FString> FailedUrls;
+
+	UPROPERTY()
+	UMaterialInstance* MeshMaterial = nullptr;
+
+	UPROPERTY()
+	UMaterialInstance* LineMaterial = nullptr;
+
+	UPROPERTY()
+	FBIMImportSettings Settings;
+
+	float RefEasting = 0.0f;
+	float RefNorthing = 0.0f;
+	float RefAltitude = 0.0f;
+	int32 Completed = 0;
+};
+
+/**
+ * Imports batches of files (e.g. the discipline models of one project) through a shared queue: a limited number of
+ * files is in flight at a time, all of them are parsed on one worker pool, and no file is started while the scenes
+ * of the manager hold more than the memory budget. Defaults come from UBIMImporterConfig
+ */
+UCLASS()
+class DXFRUNTIMEIMPORTER_API UBIMSceneManager : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Queue every file of Urls with the same reference, materials and settings. OnBatchComplete is broadcast
+	 * once all of them are ready or have failed. Returns the id the batch's events carry
+	 */
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene Manager", meta=(AutoCreateRefTerm="Settings"))
+	int32 ImportBatch(const TArray<FString>& Urls, float RefEasting, float RefNorthing, float RefAltitude, UMaterialInstance* MeshMaterial, UMaterialInstance* LineMaterial, const FBIMImportSettings& Settings);
+
+	/**
+	 * Bytes held by every scene imported through the manager
+	 */
+	UFUNCTION(BlueprintCallable, Category="DXF Importer|Scene Manager")
+	FBIMSceneMemory GetMemoryUsage() const;
+
+	// Files in flight at a time
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Scene Manager")
+	int32 MaxConcurrentImports = 4;
+
+	// Memory the manager's scenes may hold before files stop being started, 0 for no limit
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="DXF Importer|Scene Manager")
+	int32 MemoryBudgetMB = 0;
+
+	// Fired once every file of a batch is ready or has failed, with the scenes in the order of the batch's URLs
+	UPROPERTY(BlueprintAssignable, Category="DXF Importer|Scene Manager")
+	FBIMBatchCompleteDelegate OnBatchComplete;
+
+	// Fired whenever a file of a batch is ready or has failed
+	UPROPERTY(BlueprintAssignable, Category="DXF Importer|Scene Manager")
+	FBIMBatchProgressDelegate OnBatchProgress;
+
+private:
+	// Start queued files while there are free slots and memory
+	void StartJobs();
+
+	// Whether the manager's scenes hold more than the budget, after asking ready scenes to release their source data
+	bool IsOverBudget();
+
+	UFUNCTION()
+	void OnJobReady(UBIMScene* Scene);
+
+	UFUNCTION()
+	void OnJobFailed(UBIMScene* Scene, const FString& Error);
+
+	// Record the outcome of a file, free its slot and complete its batch if it was the last one
+	void FinishJob(UBIMScene* Scene, bool bSucceeded);
+
+	void CompleteBatch(int32 BatchId);
+
+	UPROPERTY(Transient)
+	TMap<int32, FBIMSceneBatch> Batches;
+	int32 NextBatchId = 0;
+
+	// (batch, file index) of files waiting for a slot, and of the scenes in flight
+	TArray<TPair<int32, int32>> PendingJobs;
+	TMap<UBIMScene*, TPair<int32, int32>> ActiveJobs;
+
+	// every scene imported so far, for the memory budget
+	TArray<TWeakObjectPtr<UBIMScene>> ManagedScenes;
+
+	// parse workers shared by all files
+	FQueuedThreadPool* ThreadPool = nullptr;
+};
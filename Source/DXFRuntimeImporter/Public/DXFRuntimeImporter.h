@@ -12,10 +12,13 @@ class UEAssimpStream : public Assimp::Logger
 {
 public:
 	// Constructor
-	UEAssimpStream()
+	UEAssimpStream() : Assimp::Logger(GetSeverity())
 	{
 		// empty
 	}
+
+	// Assimp severity matching the verbosity of LogAssimp
+	static LogSeverity GetSeverity();
         
 	// Destructor
 	virtual ~UEAssimpStream() override
@@ -30,7 +33,7 @@ public:
 	}
 	virtual void OnDebug(const char* message) override
 	{
-		UE_LOG(LogAssimp,Log,TEXT("%s"),*FString(message));
+		UE_LOG(LogAssimp,Verbose,TEXT("%s"),*FString(message));
 	}
 	virtual void OnInfo(const char* message) override
 	{
@@ -42,7 +45,7 @@ public:
 	}
 	virtual void OnVerboseDebug(const char* message) override
 	{
-		UE_LOG(LogAssimp,Warning,TEXT("%s"),*FString(message));
+		UE_LOG(LogAssimp,VeryVerbose,TEXT("%s"),*FString(message));
 	}
 	virtual bool attachStream(Assimp::LogStream* pStream, unsigned severity) override
 	{